@@ -20,40 +20,271 @@
  */
 #include "ESP8266.h"
 
-#define LOG_OUTPUT_DEBUG            (1)
-#define LOG_OUTPUT_DEBUG_PREFIX     (1)
-
-#define logDebug(arg)\
-    do {\
-        if (LOG_OUTPUT_DEBUG)\
-        {\
-            if (LOG_OUTPUT_DEBUG_PREFIX)\
-            {\
-                Serial.print("[LOG Debug: ");\
-                Serial.print((const char*)__FILE__);\
-                Serial.print(",");\
-                Serial.print((unsigned int)__LINE__);\
-                Serial.print(",");\
-                Serial.print((const char*)__FUNCTION__);\
-                Serial.print("] ");\
-            }\
-            Serial.print(arg);\
-        }\
-    } while(0)
-
-#ifdef ESP8266_USE_SOFTWARE_SERIAL
-ESP8266::ESP8266(SoftwareSerial &uart, uint32_t baud): m_puart(&uart)
-{
-    m_puart->begin(baud);
-    rx_empty();
+#ifdef __AVR__
+#include <util/atomic.h>
+#endif
+
+#if ESP8266_TRACE_LEVEL >= 1
+#define TRACE_ERROR(code, a, b) trace(code, a, b)
+#else
+#define TRACE_ERROR(code, a, b) do { } while (0)
+#endif
+#if ESP8266_TRACE_LEVEL >= 2
+#define TRACE_INFO(code, a, b)  trace(code, a, b)
+#else
+#define TRACE_INFO(code, a, b)  do { } while (0)
+#endif
+#if ESP8266_TRACE_LEVEL >= 3
+#define TRACE_DEBUG(code, a, b) trace(code, a, b)
+#else
+#define TRACE_DEBUG(code, a, b) do { } while (0)
+#endif
+
+#define IPD_SCAN    (0) /* Looking for "+IPD," */
+#define IPD_NUM1    (1) /* <id> in multiple mode or <len> in single mode */
+#define IPD_NUM2    (2) /* <len> in multiple mode */
+#define IPD_INFO    (3) /* ,<remote IP>,<remote port> added by AT+CIPDINFO=1 */
+#define IPD_DATA    (4) /* Payload, m_ipd_len bytes left */
+
+#define IPD_LEN_MAX (0xFFFF)
+
+#define CMD_FILTER_NONE (0) /* The response is not kept */
+#define CMD_FILTER_WAIT (1) /* Looking for the beginning */
+#define CMD_FILTER_COPY (2) /* Copying until the end */
+#define CMD_FILTER_DONE (3)
+
+#define RECV_GRACE  (3000)  /* The time a package being received may take */
+
+#define SEND_NONE   (0)
+#define SEND_PROMPT (1)     /* Waiting for ">" */
+#define SEND_RESULT (2)     /* Waiting for "SEND OK" */
+
+#define AP_ECN      (0) /* Fields of +CWLAP, as bits of the mask of AT+CWLAPOPT */
+#define AP_SSID     (1)
+#define AP_RSSI     (2)
+#define AP_MAC      (3)
+#define AP_CH       (4)
+#define AP_NONE     (0xFF)
+
+#define LINK_ID         (0) /* Fields of +CIPSTATUS */
+#define LINK_TYPE       (1)
+#define LINK_IP         (2)
+#define LINK_PORT       (3)
+#define LINK_LOCAL_PORT (4)
+#define LINK_SERVER     (5)
+
+#ifdef ESP8266_USE_STATS
+#define STATS(...)  do { __VA_ARGS__; } while (0)
+#else
+#define STATS(...)  do { } while (0)
+#endif
+
+#ifdef SERIAL_RX_BUFFER_SIZE
+#define RX_FULL     (SERIAL_RX_BUFFER_SIZE - 1)
+#else
+#define RX_FULL     (63)
+#endif
+
+#define PASSTHROUGH_GUARD   (1000) /* Silence around "+++" */
+
+#define BOOT_TIMEOUT (5000) /* From AT+RST to the ready banner */
+
+#define BAUD_SETTLE (20)    /* The time ESP8266 takes to change the rate after "OK" */
+#define BAUD_TRIES  (3)
+
+#define CIPSEND_MAX (2048)  /* The most bytes ESP8266 accepts at a time */
+#define SEND_CHUNK  (64)    /* Bytes read from source at a time */
+
+/*
+ * The statement after RING_ATOMIC runs with interrupts off, so that pump in an 
+ * interrupt never sees half of an index written. The interrupt state is put back 
+ * after rather than interrupts turned on: pump itself may run in an interrupt. 
+ * On Cortex-M PRIMASK is read and set by hand, as not every core has CMSIS 
+ * (Teensy 3.x does not). Elsewhere(ARM Linux, ESP8266, ...) pump must not be 
+ * called from an interrupt. 
+ */
+#if defined(__AVR__)
+#define RING_ATOMIC ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#elif defined(__ARM_ARCH_6M__) || defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__) \
+    || defined(__ARM_ARCH_8M_BASE__) || defined(__ARM_ARCH_8M_MAIN__)
+static inline uint32_t ringLock(void)
+{
+    uint32_t primask;
+    
+    __asm__ volatile ("mrs %0, primask\n\tcpsid i" : "=r" (primask) : : "memory");
+    return primask;
+}
+
+static inline void ringUnlock(uint32_t primask)
+{
+    __asm__ volatile ("msr primask, %0" : : "r" (primask) : "memory");
 }
+
+#define RING_ATOMIC for (uint32_t ring_primask = ringLock(), ring_once = 1; \
+    ring_once; ringUnlock(ring_primask), ring_once = 0)
 #else
-ESP8266::ESP8266(HardwareSerial &uart, uint32_t baud): m_puart(&uart)
+#define RING_ATOMIC
+#endif
+
+#ifdef ESP8266_USE_STATS
+static void statsCount(uint16_t *counter)
 {
-    m_puart->begin(baud);
-    rx_empty();
+    if (*counter != 0xFFFF) {
+        (*counter)++;
+    }
+}
+
+/* See ESP8266_STATS_BUCKETS. */
+static uint8_t statsBucket(unsigned long ms)
+{
+    uint8_t i = 0;
+    ms >>= 1;
+    while (ms > 0 && i < ESP8266_STATS_BUCKETS - 1) {
+        ms >>= 2;
+        i++;
+    }
+    return i;
+}
+#endif
+
+static void printIP(Stream *uart, const uint8_t *ip)
+{
+    uart->print('"');
+    for (uint8_t i = 0; i < 4; i++) {
+        if (i > 0) {
+            uart->print('.');
+        }
+        uart->print(ip[i]);
+    }
+    uart->print('"');
+}
+
+/* The "a.b.c.d" after key in list(from the beginning if key is NULL), into ip. */
+static bool parseIP(const String &list, const __FlashStringHelper *key, uint8_t *ip)
+{
+    int at = key ? list.indexOf(key) : 0;
+    uint8_t i = 0;
+    
+    if (at < 0) {
+        return false;
+    }
+    memset(ip, 0, 4);
+    if (key) {
+        at += strlen_P((const char *)key);
+    }
+    if (at < (int)list.length() && list[at] == '"') {
+        /* +CIPDOMAIN:"a.b.c.d" of some firmwares */
+        at++;
+    }
+    for (; at < (int)list.length() && list[at] != '"'; at++) {
+        if (list[at] == '.') {
+            if (++i == 4) {
+                return false;
+            }
+        } else if (list[at] >= '0' && list[at] <= '9') {
+            ip[i] = ip[i] * 10 + (list[at] - '0');
+        }
+    }
+    return i == 3;
+}
+
+/* Whether host is a dotted IP address rather than a name. */
+static bool isNumericHost(const String &host)
+{
+    for (unsigned int i = 0; i < host.length(); i++) {
+        if (host[i] != '.' && (host[i] < '0' || host[i] > '9')) {
+            return false;
+        }
+    }
+    return host.length() > 0;
 }
+
+void ESP8266::init(uint32_t baud)
+{
+    m_ipd_state = IPD_SCAN;
+    m_ipd_pos = 0;
+    m_ipd_id = -1;
+    m_ipd_len = 0;
+    memset(m_link, 0, sizeof(m_link));
+    m_link_next = 0;
+    m_ring = NULL;
+    m_ring_size = 0;
+    m_ring_head = 0;
+    m_ring_tail = 0;
+    m_ring_pumping = false;
+    m_ring_overflow = 0;
+    
+    m_sink = NULL;
+    m_sink_size = 0;
+    m_sink_len = 0;
+    m_sink_id = -1;
+    m_sink_from = -1;
+    m_sink_done = false;
+    
+    m_cmd = ESP8266_CMD_NONE;
+    m_cmd_ok = false;
+    m_cmd_filter = CMD_FILTER_NONE;
+    m_cmd_data = NULL;
+    m_cmd_start = 0;
+    m_cmd_timeout = 0;
+    m_send_state = SEND_NONE;
+    m_send_mux = -1;
+    m_send_seg = NULL;
+    m_send_segs = 0;
+    m_send_pos = 0;
+    m_send_len = 0;
+    m_send_pkg = 0;
+    m_send_short = false;
+    m_send_seg_id = 0;
+    m_seq = NULL;
+    m_seq_left = 0;
+    m_seq_sent = false;
+    m_seq_start = 0;
+    m_passthrough = false;
+    m_boot_time = 0;
+    m_cur_commands = -1;
+    m_join_time = 0;
+#if ESP8266_DNS_CACHE > 0
+    memset(m_dns, 0, sizeof(m_dns));
+    m_dns_ttl = 300000UL;
+    m_dns_used = -1;
+#endif
+    m_baud = baud;
+    m_boot_baud = baud;
+    m_line_len = 0;
+    m_events = 0;
+    m_ready = false;
+    m_must_restart = false;
+    
+    m_fld_end = '\0';
+    m_fld_index = -1;
+    m_ap_cb = NULL;
+    m_ap_arg = NULL;
+    m_ap_mask = 0x1F;
+    for (uint8_t i = 0; i < 5; i++) {
+        linkReset(i, false);
+        windowReset(i, false);
+    }
+    
+    m_data_cb = NULL;
+    m_data_arg = NULL;
+    m_link_cb = NULL;
+    m_link_arg = NULL;
+    m_wifi_cb = NULL;
+    m_wifi_arg = NULL;
+    m_cmd_cb = NULL;
+    m_cmd_arg = NULL;
+    m_idle_cb = NULL;
+    m_idle_arg = NULL;
+    STATS(resetStats(), m_stats_start = 0);
+#if ESP8266_TRACE_LEVEL > 0
+    m_trace_next = 0;
+    m_trace_count = 0;
 #endif
+    
+    m_uart_begin(m_puart, baud);
+    rx_empty();
+}
 
 bool ESP8266::kick(void)
 {
@@ -62,19 +293,37 @@ bool ESP8266::kick(void)
 
 bool ESP8266::restart(void)
 {
-    unsigned long start;
-    if (eATRST()) {
-        delay(2000);
-        start = millis();
-        while (millis() - start < 3000) {
-            if (eAT()) {
-                delay(1500); /* Waiting for stable */
-                return true;
-            }
-            delay(100);
-        }
+    unsigned long start = millis();
+    
+    /* The banner ESP8266 prints when it can take commands again. */
+    m_ready = false;
+    if (!eATRST()) {
+        return false;
     }
-    return false;
+    for (uint8_t i = 0; i < 5; i++) {
+        linkReset(i, false);
+        windowReset(i, true);
+    }
+    if (m_baud != m_boot_baud) {
+        /* ESP8266 starts with its saved rate. */
+        m_puart->flush();
+        m_uart_begin(m_puart, m_boot_baud);
+        m_baud = m_boot_baud;
+    }
+    while (!m_ready && millis() - start < BOOT_TIMEOUT) {
+        waitStep();
+    }
+    /* Without the banner(some firmwares do not print it), ask. */
+    if (!eAT()) {
+        return false;
+    }
+    m_boot_time = millis() - start;
+    return true;
+}
+
+uint32_t ESP8266::getBootTime(void)
+{
+    return m_boot_time;
 }
 
 String ESP8266::getVersion(void)
@@ -84,55 +333,84 @@ String ESP8266::getVersion(void)
     return version;
 }
 
-bool ESP8266::setOprToStation(void)
+bool ESP8266::setUARTBaud(uint32_t baud, bool persistent)
 {
-    uint8_t mode;
-    if (!qATCWMODE(&mode)) {
+    uint32_t old = m_baud;
+    
+    if (!sATUART(baud, persistent)) {
         return false;
     }
-    if (mode == 1) {
-        return true;
-    } else {
-        if (sATCWMODE(1) && restart()) {
+    m_puart->flush();
+    delay(BAUD_SETTLE);
+    m_uart_begin(m_puart, baud);
+    m_baud = baud;
+    if (persistent) {
+        m_boot_baud = baud;
+    }
+    for (uint8_t i = 0; i < BAUD_TRIES; i++) {
+        if (eAT()) {
             return true;
-        } else {
-            return false;
         }
     }
+    
+    /* 
+     * The answer is lost at the new rate but ESP8266 may still hear us: 
+     * ask it to go back without waiting for the answer. 
+     */
+    sATUART(old, persistent);
+    m_puart->flush();
+    delay(BAUD_SETTLE);
+    m_uart_begin(m_puart, old);
+    m_baud = old;
+    if (persistent) {
+        m_boot_baud = old;
+    }
+    eAT();
+    return false;
 }
 
-bool ESP8266::setOprToSoftAP(void)
+uint32_t ESP8266::getUARTBaud(void)
+{
+    return m_baud;
+}
+
+bool ESP8266::setOprMode(uint8_t mode)
 {
-    uint8_t mode;
-    if (!qATCWMODE(&mode)) {
+    uint8_t current;
+    if (!qATCWMODE(&current)) {
         return false;
     }
-    if (mode == 2) {
+    if (current == mode) {
         return true;
-    } else {
-        if (sATCWMODE(2) && restart()) {
-            return true;
-        } else {
-            return false;
-        }
     }
+    if (hasCurCommands()) {
+        /* At once, without restarting. */
+        return sATCWMODECUR(mode);
+    }
+    return sATCWMODE(mode) && restart();
 }
 
-bool ESP8266::setOprToStationSoftAP(void)
+bool ESP8266::hasCurCommands(void)
 {
-    uint8_t mode;
-    if (!qATCWMODE(&mode)) {
-        return false;
-    }
-    if (mode == 3) {
-        return true;
-    } else {
-        if (sATCWMODE(3) && restart()) {
-            return true;
-        } else {
-            return false;
-        }
+    if (m_cur_commands < 0) {
+        m_cur_commands = qATCWMODECUR() ? 1 : 0;
     }
+    return m_cur_commands == 1;
+}
+
+bool ESP8266::setOprToStation(void)
+{
+    return setOprMode(1);
+}
+
+bool ESP8266::setOprToSoftAP(void)
+{
+    return setOprMode(2);
+}
+
+bool ESP8266::setOprToStationSoftAP(void)
+{
+    return setOprMode(3);
 }
 
 String ESP8266::getAPList(void)
@@ -142,9 +420,62 @@ String ESP8266::getAPList(void)
     return list;
 }
 
+bool ESP8266::scanAP(ESP8266APCallback cb, void *arg, const char *ssid)
+{
+    bool ret;
+    if (cb == NULL) {
+        return false;
+    }
+    ret = sATCWLAP(cb, arg, ssid);
+    m_ap_cb = NULL;
+    return ret;
+}
+
+bool ESP8266::setAPListOption(bool sort, uint16_t mask)
+{
+    if (!sATCWLAPOPT(sort, mask)) {
+        return false;
+    }
+    m_ap_mask = mask;
+    return true;
+}
+
 bool ESP8266::joinAP(String ssid, String pwd)
 {
-    return sATCWJAP(ssid, pwd);
+    unsigned long start = millis();
+    bool ret = sATCWJAP(ssid, pwd) && cmdWait();
+    m_join_time = millis() - start;
+    return ret;
+}
+
+bool ESP8266::joinAPFast(String ssid, String pwd, ESP8266JoinCache *cache, bool static_ip)
+{
+    unsigned long start = millis();
+    bool fixed = false;
+    bool ret = false;
+    
+    if (cache->valid && hasCurCommands()) {
+        fixed = static_ip && cache->ip[0] != 0
+            && sATCIPSTACUR(cache->ip, cache->gateway, cache->netmask);
+        ret = sATCWJAPCUR(ssid, pwd, cache->bssid);
+        if (!ret && fixed) {
+            /* The full join below asks DHCP again. */
+            sATCWDHCPCUR(true);
+        }
+    }
+    if (!ret) {
+        ret = sATCWJAP(ssid, pwd) && cmdWait();
+        if (ret) {
+            cache->valid = qATCWJAP(cache) && qATCIPSTA(cache);
+        }
+    }
+    m_join_time = millis() - start;
+    return ret;
+}
+
+uint32_t ESP8266::getJoinTime(void)
+{
+    return m_join_time;
 }
 
 bool ESP8266::leaveAP(void)
@@ -171,6 +502,27 @@ String ESP8266::getIPStatus(void)
     return list;
 }
 
+bool ESP8266::updateLinkStatus(void)
+{
+    return eATCIPSTATUS();
+}
+
+const ESP8266LinkStatus *ESP8266::getLinkStatus(uint8_t mux_id)
+{
+    if (mux_id >= 5) {
+        return NULL;
+    }
+    if (m_link_status[mux_id].open && !m_link_status[mux_id].known) {
+        eATCIPSTATUS();
+    }
+    return &m_link_status[mux_id];
+}
+
+bool ESP8266::isLinkOpen(uint8_t mux_id)
+{
+    return mux_id < 5 && m_link_status[mux_id].open;
+}
+
 String ESP8266::getLocalIP(void)
 {
     String list;
@@ -190,42 +542,80 @@ bool ESP8266::disableMUX(void)
 
 bool ESP8266::createTCP(String addr, uint32_t port)
 {
-    return sATCIPSTARTSingle("TCP", addr, port);
+    return sATCIPSTARTSingle(F("TCP"), addr, port, true) && cmdWait();
 }
 
 bool ESP8266::releaseTCP(void)
 {
-    return eATCIPCLOSESingle();
+    return eATCIPCLOSESingle() && cmdWait();
 }
 
 bool ESP8266::registerUDP(String addr, uint32_t port)
 {
-    return sATCIPSTARTSingle("UDP", addr, port);
+    return sATCIPSTARTSingle(F("UDP"), addr, port, true) && cmdWait();
 }
 
 bool ESP8266::unregisterUDP(void)
 {
-    return eATCIPCLOSESingle();
+    return eATCIPCLOSESingle() && cmdWait();
 }
 
 bool ESP8266::createTCP(uint8_t mux_id, String addr, uint32_t port)
 {
-    return sATCIPSTARTMultiple(mux_id, "TCP", addr, port);
+    return sATCIPSTARTMultiple(mux_id, F("TCP"), addr, port, true) && cmdWait();
 }
 
 bool ESP8266::releaseTCP(uint8_t mux_id)
 {
-    return sATCIPCLOSEMulitple(mux_id);
+    return sATCIPCLOSEMulitple(mux_id) && cmdWait();
 }
 
 bool ESP8266::registerUDP(uint8_t mux_id, String addr, uint32_t port)
 {
-    return sATCIPSTARTMultiple(mux_id, "UDP", addr, port);
+    return sATCIPSTARTMultiple(mux_id, F("UDP"), addr, port, true) && cmdWait();
 }
 
 bool ESP8266::unregisterUDP(uint8_t mux_id)
 {
-    return sATCIPCLOSEMulitple(mux_id);
+    return sATCIPCLOSEMulitple(mux_id) && cmdWait();
+}
+
+bool ESP8266::resolveHost(String host, uint8_t *ip)
+{
+    if (isNumericHost(host)) {
+        return parseIP(host, NULL, ip);
+    }
+#if ESP8266_DNS_CACHE > 0
+    if (m_dns_ttl > 0 && host.length() <= ESP8266_DNS_NAME_MAX) {
+        int8_t entry = dnsFind(host, true);
+        if (entry < 0) {
+            return false;
+        }
+        memcpy(ip, m_dns[entry].ip, 4);
+        return true;
+    }
+#endif
+    return sATCIPDOMAIN(host, ip);
+}
+
+void ESP8266::setDNSCacheTTL(uint32_t ttl)
+{
+#if ESP8266_DNS_CACHE > 0
+    /* In ms within uint32_t, as millis() counts. */
+    m_dns_ttl = ttl > 0xFFFFFFFFUL / 1000 ? 0xFFFFFFFFUL : ttl * 1000;
+    if (ttl == 0) {
+        flushDNSCache();
+    }
+#endif
+}
+
+void ESP8266::flushDNSCache(void)
+{
+#if ESP8266_DNS_CACHE > 0
+    for (uint8_t i = 0; i < ESP8266_DNS_CACHE; i++) {
+        m_dns[i].name[0] = '\0';
+    }
+#endif
 }
 
 bool ESP8266::setTCPServerTimeout(uint32_t timeout)
@@ -243,8 +633,13 @@ bool ESP8266::startTCPServer(uint32_t port)
 
 bool ESP8266::stopTCPServer(void)
 {
-    sATCIPSERVER(0);
-    restart();
+    if (sATCIPSERVER(0)) {
+        return true;
+    }
+    /* Older firmwares only close the server by restarting. */
+    if (m_must_restart) {
+        return restart();
+    }
     return false;
 }
 
@@ -260,228 +655,1533 @@ bool ESP8266::stopServer(void)
 
 bool ESP8266::send(const uint8_t *buffer, uint32_t len)
 {
-    return sATCIPSENDSingle(buffer, len);
+    return sATCIPSENDSingle(buffer, len) && cmdWait();
 }
 
 bool ESP8266::send(uint8_t mux_id, const uint8_t *buffer, uint32_t len)
 {
-    return sATCIPSENDMultiple(mux_id, buffer, len);
+    return sATCIPSENDMultiple(mux_id, buffer, len) && cmdWait();
 }
 
-uint32_t ESP8266::recv(uint8_t *buffer, uint32_t buffer_size, uint32_t timeout)
+bool ESP8266::sendStream(ESP8266SourceCallback source, void *arg, uint32_t len)
 {
-    return recvPkg(buffer, buffer_size, NULL, timeout, NULL);
+    if (source == NULL) {
+        return false;
+    }
+    sendBegin(-1, ESP8266_SEGMENT_SOURCE, arg, len, source);
+    return cmdWait();
 }
 
-uint32_t ESP8266::recv(uint8_t mux_id, uint8_t *buffer, uint32_t buffer_size, uint32_t timeout)
+bool ESP8266::sendStream(uint8_t mux_id, ESP8266SourceCallback source, void *arg, uint32_t len)
 {
-    uint8_t id;
-    uint32_t ret;
-    ret = recvPkg(buffer, buffer_size, NULL, timeout, &id);
-    if (ret > 0 && id == mux_id) {
-        return ret;
+    if (source == NULL) {
+        return false;
     }
-    return 0;
+    sendBegin(mux_id, ESP8266_SEGMENT_SOURCE, arg, len, source);
+    return cmdWait();
 }
 
-uint32_t ESP8266::recv(uint8_t *coming_mux_id, uint8_t *buffer, uint32_t buffer_size, uint32_t timeout)
+bool ESP8266::send(const ESP8266Segment *segs, uint8_t count)
 {
-    return recvPkg(buffer, buffer_size, NULL, timeout, coming_mux_id);
+    sendBegin(-1, segs, count);
+    return cmdWait();
 }
 
-/*----------------------------------------------------------------------------*/
-/* +IPD,<id>,<len>:<data> */
-/* +IPD,<len>:<data> */
+bool ESP8266::send(uint8_t mux_id, const ESP8266Segment *segs, uint8_t count)
+{
+    sendBegin(mux_id, segs, count);
+    return cmdWait();
+}
 
-uint32_t ESP8266::recvPkg(uint8_t *buffer, uint32_t buffer_size, uint32_t *data_len, uint32_t timeout, uint8_t *coming_mux_id)
+bool ESP8266::sendBuffered(uint8_t mux_id, const uint8_t *buffer, uint32_t len, uint32_t timeout)
 {
-    String data;
-    char a;
-    int32_t index_PIPDcomma = -1;
-    int32_t index_colon = -1; /* : */
-    int32_t index_comma = -1; /* , */
-    int32_t len = -1;
-    int8_t id = -1;
-    bool has_data = false;
-    uint32_t ret;
-    unsigned long start;
-    uint32_t i;
+    unsigned long start = millis();
+    uint32_t n;
+    uint8_t used;
     
-    if (buffer == NULL) {
-        return 0;
+    if (mux_id >= 5 || buffer == NULL) {
+        return false;
     }
-    
-    start = millis();
-    while (millis() - start < timeout) {
-        if(m_puart->available() > 0) {
-            a = m_puart->read();
-            data += a;
-        }
-        
-        index_PIPDcomma = data.indexOf("+IPD,");
-        if (index_PIPDcomma != -1) {
-            index_colon = data.indexOf(':', index_PIPDcomma + 5);
-            if (index_colon != -1) {
-                index_comma = data.indexOf(',', index_PIPDcomma + 5);
-                /* +IPD,id,len:data */
-                if (index_comma != -1 && index_comma < index_colon) { 
-                    id = data.substring(index_PIPDcomma + 5, index_comma).toInt();
-                    if (id < 0 || id > 4) {
-                        return 0;
-                    }
-                    len = data.substring(index_comma + 1, index_colon).toInt();
-                    if (len <= 0) {
-                        return 0;
-                    }
-                } else { /* +IPD,len:data */
-                    len = data.substring(index_PIPDcomma + 5, index_colon).toInt();
-                    if (len <= 0) {
-                        return 0;
-                    }
-                }
-                has_data = true;
-                break;
-            }
+    while (len > 0) {
+        n = len < CIPSEND_MAX ? len : CIPSEND_MAX;
+        if (!windowWait(mux_id, ESP8266_SEND_WINDOW - 1, start, timeout)) {
+            return false;
         }
-    }
-    
-    if (has_data) {
-        i = 0;
-        ret = len > buffer_size ? buffer_size : len;
-        start = millis();
-        while (millis() - start < 3000) {
-            while(m_puart->available() > 0 && i < ret) {
-                a = m_puart->read();
-                buffer[i++] = a;
-            }
-            if (i == ret) {
-                rx_empty();
-                if (data_len) {
-                    *data_len = len;    
-                }
-                if (index_comma != -1 && coming_mux_id) {
-                    *coming_mux_id = id;
-                }
-                return ret;
-            }
+        if (sATCIPSENDBUF(mux_id, buffer, n) && cmdWait()) {
+            buffer += n;
+            len -= n;
+            continue;
+        }
+        /* Refused while packages are in flight: the buffer of ESP8266 is full. */
+        used = getBufferedCount(mux_id);
+        if (used == 0 || !isLinkOpen(mux_id) || !windowWait(mux_id, used - 1, start, timeout)) {
+            return false;
         }
     }
-    return 0;
+    return true;
 }
 
-void ESP8266::rx_empty(void) 
+bool ESP8266::flushBuffered(uint8_t mux_id, uint32_t timeout)
 {
-    while(m_puart->available() > 0) {
-        m_puart->read();
+    bool ret;
+    
+    if (mux_id >= 5) {
+        return false;
     }
+    ret = windowWait(mux_id, 0, millis(), timeout);
+    m_window[mux_id].failed = false;
+    return ret;
 }
 
-String ESP8266::recvString(String target, uint32_t timeout)
+uint8_t ESP8266::getBufferedCount(uint8_t mux_id)
 {
-    String data;
-    char a;
-    unsigned long start = millis();
-    while (millis() - start < timeout) {
-        while(m_puart->available() > 0) {
-            a = m_puart->read();
-			if(a == '\0') continue;
-            data += a;
-        }
-        if (data.indexOf(target) != -1) {
-            break;
-        }   
+    poll();
+    if (mux_id >= 5) {
+        return 0;
     }
-    return data;
+    return (uint16_t)(m_window[mux_id].queued - m_window[mux_id].acked);
 }
 
-String ESP8266::recvString(String target1, String target2, uint32_t timeout)
+uint32_t ESP8266::recv(uint8_t *buffer, uint32_t buffer_size, uint32_t timeout)
 {
-    String data;
-    char a;
-    unsigned long start = millis();
-    while (millis() - start < timeout) {
-        while(m_puart->available() > 0) {
-            a = m_puart->read();
-			if(a == '\0') continue;
-            data += a;
-        }
-        if (data.indexOf(target1) != -1) {
-            break;
-        } else if (data.indexOf(target2) != -1) {
-            break;
-        }
+    uint32_t ret;
+    ret = dequeue(0, buffer, buffer_size);
+    if (ret > 0) {
+        return ret;
     }
-    return data;
+    return recvPkg(buffer, buffer_size, NULL, timeout, NULL);
 }
 
-String ESP8266::recvString(String target1, String target2, String target3, uint32_t timeout)
+uint32_t ESP8266::recv(uint8_t mux_id, uint8_t *buffer, uint32_t buffer_size, uint32_t timeout)
 {
-    String data;
-    char a;
-    unsigned long start = millis();
-    while (millis() - start < timeout) {
-        while(m_puart->available() > 0) {
-            a = m_puart->read();
-			if(a == '\0') continue;
-            data += a;
-        }
-        if (data.indexOf(target1) != -1) {
-            break;
-        } else if (data.indexOf(target2) != -1) {
-            break;
-        } else if (data.indexOf(target3) != -1) {
+    uint32_t ret;
+    if (mux_id >= 5) {
+        return 0;
+    }
+    ret = dequeue(mux_id, buffer, buffer_size);
+    if (ret > 0) {
+        return ret;
+    }
+    return recvPkg(buffer, buffer_size, NULL, timeout, NULL, mux_id);
+}
+
+uint32_t ESP8266::recv(uint8_t *coming_mux_id, uint8_t *buffer, uint32_t buffer_size, uint32_t timeout)
+{
+    uint32_t ret;
+    uint8_t id;
+    for (uint8_t i = 0; i < 5; i++) {
+        id = (m_link_next + i) % 5;
+        ret = dequeue(id, buffer, buffer_size);
+        if (ret > 0) {
+            m_link_next = (id + 1) % 5;
+            if (coming_mux_id) {
+                *coming_mux_id = id;
+            }
+            return ret;
+        }
+    }
+    return recvPkg(buffer, buffer_size, NULL, timeout, coming_mux_id);
+}
+
+bool ESP8266::setRecvBuffer(uint8_t mux_id, uint8_t *buffer, uint32_t buffer_size)
+{
+    if (mux_id >= 5 || buffer_size > 0xFFFF) {
+        return false;
+    }
+    m_link[mux_id].buffer = buffer;
+    m_link[mux_id].size = buffer ? buffer_size : 0;
+    m_link[mux_id].head = 0;
+    m_link[mux_id].count = 0;
+    return true;
+}
+
+uint32_t ESP8266::available(uint8_t mux_id)
+{
+    if (mux_id >= 5) {
+        return 0;
+    }
+    return m_link[mux_id].count;
+}
+
+uint32_t ESP8266::getOverflowCount(uint8_t mux_id)
+{
+    if (mux_id >= 5) {
+        return 0;
+    }
+    return m_link[mux_id].overflow;
+}
+
+void ESP8266::setRxRing(uint8_t *buffer, uint16_t size)
+{
+    RING_ATOMIC {
+        m_ring = size >= 2 ? buffer : NULL;
+        m_ring_size = m_ring ? size : 0;
+        m_ring_head = 0;
+        m_ring_tail = 0;
+    }
+}
+
+uint16_t ESP8266::pump(void)
+{
+    uint8_t scratch[16];
+    uint16_t moved = 0;
+    uint16_t head;
+    uint16_t tail;
+    uint16_t room;
+    uint16_t n;
+    
+    if (m_ring == NULL || m_ring_pumping || m_passthrough) {
+        return 0;
+    }
+    m_ring_pumping = true;
+    head = m_ring_head;
+    RING_ATOMIC {
+        tail = m_ring_tail;
+    }
+    do {
+        /* Free bytes up to the end of the ring or to the one before tail. */
+        if (tail > head) {
+            room = tail - head - 1;
+        } else {
+            room = m_ring_size - head - (tail == 0 ? 1 : 0);
+        }
+        if (room > 0) {
+            n = m_uart_read(m_puart, m_ring + head, room);
+            head += n;
+            if (head == m_ring_size) {
+                head = 0;
+            }
+            m_ring_head = head;
+        } else {
+            /* Full: the UART is emptied all the same, so that its own buffer can take more. */
+            n = m_uart_read(m_puart, scratch, sizeof(scratch));
+            m_ring_overflow += n;
+        }
+        moved += n;
+    } while (n > 0);
+    m_ring_pumping = false;
+    return moved;
+}
+
+uint32_t ESP8266::getRxRingOverflow(void)
+{
+    uint32_t n;
+    
+    RING_ATOMIC {
+        n = m_ring_overflow;
+    }
+    return n;
+}
+
+#ifdef ESP8266_USE_STATS
+void ESP8266::getStats(ESP8266Stats *stats)
+{
+    memcpy(stats, &m_stats, sizeof(m_stats));
+}
+
+void ESP8266::resetStats(void)
+{
+    memset(&m_stats, 0, sizeof(m_stats));
+}
+#endif
+
+#if ESP8266_TRACE_LEVEL > 0
+static void printHex(Print &out, uint32_t value, uint8_t digits)
+{
+    while (digits-- > 0) {
+        out.print((value >> (digits * 4)) & 0xF, HEX);
+    }
+}
+
+void ESP8266::dumpTrace(Print &out)
+{
+    uint16_t i = (m_trace_next - m_trace_count) & (ESP8266_TRACE_SIZE - 1);
+    uint16_t n;
+    
+    out.println(F("ESP8266 TRACE BEGIN"));
+    for (n = 0; n < m_trace_count; n++) {
+        const ESP8266TraceEntry &e = m_trace[i];
+        printHex(out, e.time, 8);
+        out.print(' ');
+        printHex(out, e.code, 2);
+        out.print(' ');
+        printHex(out, e.a, 2);
+        out.print(' ');
+        printHex(out, e.b, 4);
+        out.println();
+        i = (i + 1) & (ESP8266_TRACE_SIZE - 1);
+    }
+    out.println(F("ESP8266 TRACE END"));
+}
+
+void ESP8266::trace(uint8_t code, uint8_t a, uint16_t b)
+{
+    ESP8266TraceEntry *e = &m_trace[m_trace_next];
+    e->time = micros();
+    e->code = code;
+    e->a = a;
+    e->b = b;
+    m_trace_next = (m_trace_next + 1) & (ESP8266_TRACE_SIZE - 1);
+    if (m_trace_count < ESP8266_TRACE_SIZE) {
+        m_trace_count++;
+    }
+}
+#endif
+
+void ESP8266::poll(void)
+{
+    if (m_passthrough && m_cmd == ESP8266_CMD_NONE) {
+        /* Data belongs to the stream. */
+        return;
+    }
+    if (m_seq && m_cmd == ESP8266_CMD_NONE) {
+        /* Before reading, so the wait of a command sent meanwhile is not extended by a step. */
+        seqNext();
+    }
+    rx_dispatch();
+    if (m_cmd != ESP8266_CMD_NONE && millis() - m_cmd_start >= m_cmd_timeout) {
+        STATS(statsCount(&m_stats.command[m_cmd].timeouts));
+        TRACE_ERROR(ESP8266_TRACE_TIMEOUT, m_cmd, m_cmd_timeout > 0xFFFF ? 0xFFFF : m_cmd_timeout);
+        cmdEnd(false);
+    }
+}
+
+bool ESP8266::isBusy(void)
+{
+    return m_cmd != ESP8266_CMD_NONE || m_seq != NULL;
+}
+
+uint8_t ESP8266::getEvents(void)
+{
+    uint8_t events;
+    poll();
+    events = m_events;
+    m_events = 0;
+    return events;
+}
+
+void ESP8266::setDataCallback(ESP8266DataCallback cb, void *arg)
+{
+    m_data_cb = cb;
+    m_data_arg = arg;
+}
+
+void ESP8266::setLinkCallback(ESP8266LinkCallback cb, void *arg)
+{
+    m_link_cb = cb;
+    m_link_arg = arg;
+}
+
+void ESP8266::setWiFiCallback(ESP8266WiFiCallback cb, void *arg)
+{
+    m_wifi_cb = cb;
+    m_wifi_arg = arg;
+}
+
+void ESP8266::setCommandCallback(ESP8266CommandCallback cb, void *arg)
+{
+    m_cmd_cb = cb;
+    m_cmd_arg = arg;
+}
+
+void ESP8266::setIdleCallback(ESP8266IdleCallback cb, void *arg)
+{
+    m_idle_cb = cb;
+    m_idle_arg = arg;
+}
+
+bool ESP8266::joinAPAsync(String ssid, String pwd)
+{
+    if (isBusy()) {
+        return false;
+    }
+    return sATCWJAP(ssid, pwd);
+}
+
+bool ESP8266::createTCPAsync(String addr, uint32_t port)
+{
+    if (isBusy()) {
+        return false;
+    }
+    return sATCIPSTARTSingle(F("TCP"), addr, port, false);
+}
+
+bool ESP8266::createTCPAsync(uint8_t mux_id, String addr, uint32_t port)
+{
+    if (isBusy()) {
+        return false;
+    }
+    return sATCIPSTARTMultiple(mux_id, F("TCP"), addr, port, false);
+}
+
+bool ESP8266::registerUDPAsync(String addr, uint32_t port)
+{
+    if (isBusy()) {
+        return false;
+    }
+    return sATCIPSTARTSingle(F("UDP"), addr, port, false);
+}
+
+bool ESP8266::registerUDPAsync(uint8_t mux_id, String addr, uint32_t port)
+{
+    if (isBusy()) {
+        return false;
+    }
+    return sATCIPSTARTMultiple(mux_id, F("UDP"), addr, port, false);
+}
+
+bool ESP8266::releaseTCPAsync(void)
+{
+    if (isBusy()) {
+        return false;
+    }
+    return eATCIPCLOSESingle();
+}
+
+bool ESP8266::releaseTCPAsync(uint8_t mux_id)
+{
+    if (isBusy()) {
+        return false;
+    }
+    return sATCIPCLOSEMulitple(mux_id);
+}
+
+bool ESP8266::sendAsync(const uint8_t *buffer, uint32_t len)
+{
+    if (isBusy()) {
+        return false;
+    }
+    return sATCIPSENDSingle(buffer, len);
+}
+
+bool ESP8266::sendAsync(uint8_t mux_id, const uint8_t *buffer, uint32_t len)
+{
+    if (isBusy()) {
+        return false;
+    }
+    return sATCIPSENDMultiple(mux_id, buffer, len);
+}
+
+uint8_t ESP8266::runSequence(ESP8266Step *steps, uint8_t count)
+{
+    uint8_t done = 0;
+    
+    while (isBusy()) {
+        waitStep();
+    }
+    if (!runSequenceAsync(steps, count)) {
+        /* Not busy any more, so the steps are at fault. */
+        return ESP8266_SEQUENCE_REFUSED;
+    }
+    while (m_seq) {
+        waitStep();
+    }
+    while (done < count && steps[done].ok) {
+        done++;
+    }
+    return done;
+}
+
+bool ESP8266::runSequenceAsync(ESP8266Step *steps, uint8_t count)
+{
+    if (isBusy() || count >= ESP8266_SEQUENCE_REFUSED) {
+        return false;
+    }
+    for (uint8_t i = 0; i < count; i++) {
+        switch (steps[i].command) {
+        case ESP8266_CMD_NONE:
+        case ESP8266_CMD_RST:
+        case ESP8266_CMD_UART:
+        case ESP8266_CMD_CIPSEND:
+        case ESP8266_CMD_CIPSENDBUF:
+            return false;
+        }
+        if (steps[i].command >= ESP8266_CMD_COUNT) {
+            return false;
+        }
+        steps[i].ok = false;
+        steps[i].time = 0;
+    }
+    m_seq = count > 0 ? steps : NULL;
+    m_seq_left = count;
+    m_seq_sent = false;
+    return true;
+}
+
+bool ESP8266::enterPassthrough(void)
+{
+    if (m_passthrough) {
+        return true;
+    }
+    if (!sATCIPMODE(1)) {
+        return false;
+    }
+    if (!eATCIPSENDPassthrough()) {
+        sATCIPMODE(0);
+        return false;
+    }
+    return true;
+}
+
+bool ESP8266::exitPassthrough(void)
+{
+    if (!m_passthrough) {
+        return true;
+    }
+    m_puart->flush();
+    delay(PASSTHROUGH_GUARD);
+    m_puart->print(F("+++"));
+    m_puart->flush();
+    delay(PASSTHROUGH_GUARD);
+    m_passthrough = false;
+    return sATCIPMODE(0);
+}
+
+bool ESP8266::isPassthrough(void)
+{
+    return m_passthrough;
+}
+
+Stream *ESP8266::getPassthroughStream(void)
+{
+    return m_passthrough ? m_puart : NULL;
+}
+
+uint32_t ESP8266::dequeue(uint8_t mux_id, uint8_t *buffer, uint32_t buffer_size)
+{
+    LinkBuffer *link = &m_link[mux_id];
+    uint32_t i = 0;
+    
+    if (buffer == NULL) {
+        return 0;
+    }
+    while (i < buffer_size && link->count > 0) {
+        buffer[i++] = link->buffer[link->head];
+        link->head = (link->head + 1) % link->size;
+        link->count--;
+    }
+    return i;
+}
+
+/*----------------------------------------------------------------------------*/
+/* +IPD,<id>,<len>:<data> */
+/* +IPD,<len>:<data> */
+
+bool ESP8266::ipdStep(char c)
+{
+    static const char prefix[] PROGMEM = "+IPD,";
+    
+    switch (m_ipd_state) {
+    case IPD_SCAN:
+        if (c == (char)pgm_read_byte(&prefix[m_ipd_pos])) {
+            if (++m_ipd_pos == sizeof(prefix) - 1) {
+                m_ipd_state = IPD_NUM1;
+                m_ipd_pos = 0;
+                m_ipd_id = -1;
+                m_ipd_len = 0;
+            }
+        } else {
+            m_ipd_pos = (c == (char)pgm_read_byte(&prefix[0])) ? 1 : 0;
+        }
+        return false;
+    case IPD_NUM1:
+    case IPD_NUM2:
+        if (c >= '0' && c <= '9') {
+            m_ipd_len = m_ipd_len * 10 + (c - '0');
+            if (m_ipd_len <= IPD_LEN_MAX) {
+                return false;
+            }
+        } else if (c == ',' && m_ipd_state == IPD_NUM1) {
+            if (m_ipd_len <= 4) {
+                /* <id>, or a short <len> followed by the address: the next field tells. */
+                m_ipd_id = m_ipd_len;
+                m_ipd_len = 0;
+                m_ipd_state = IPD_NUM2;
+            } else {
+                /* <len>,<remote IP>,<remote port> in single mode */
+                m_ipd_state = IPD_INFO;
+            }
+            return false;
+        } else if (c == ',' && m_ipd_state == IPD_NUM2) {
+            m_ipd_state = IPD_INFO;
+            return false;
+        } else if (c == ':') {
+            break;
+        } else if (m_ipd_state == IPD_NUM2 && (c == '.' || c == '"')) {
+            /* The address in single mode: the first field was <len>. */
+            m_ipd_len = m_ipd_id;
+            m_ipd_id = -1;
+            m_ipd_state = IPD_INFO;
+            return false;
+        }
+        m_ipd_state = IPD_SCAN;
+        return false;
+    case IPD_INFO:
+        if (c == ':') {
+            break;
+        }
+        return false;
+    default:
+        return false;
+    }
+    
+    /* Header ended */
+    TRACE_DEBUG(ESP8266_TRACE_IPD, (uint8_t)m_ipd_id, m_ipd_len > 0xFFFF ? 0xFFFF : m_ipd_len);
+    m_ipd_state = m_ipd_len > 0 ? IPD_DATA : IPD_SCAN;
+    return m_ipd_state == IPD_DATA;
+}
+
+uint32_t ESP8266::recvPkg(uint8_t *buffer, uint32_t buffer_size, uint32_t *data_len, uint32_t timeout, uint8_t *coming_mux_id, int8_t mux_id)
+{
+    uint32_t limit = timeout;
+    unsigned long start;
+    bool started = false;
+    
+    if (buffer == NULL) {
+        return 0;
+    }
+    
+    m_sink = buffer;
+    m_sink_size = buffer_size;
+    m_sink_len = 0;
+    m_sink_id = mux_id;
+    m_sink_from = -1;
+    m_sink_done = false;
+    
+    start = millis();
+    while (millis() - start < limit) {
+        waitStep();
+        if (m_sink_done) {
+            break;
+        }
+        if (!started && (m_sink_len > 0 || (m_ipd_state == IPD_DATA 
+            && (mux_id < 0 || m_ipd_id < 0 || m_ipd_id == mux_id)))) {
+            /* The package has begun, give it time to come in. */
+            started = true;
+            start = millis();
+            limit = RECV_GRACE;
+        }
+    }
+    if (started && !m_sink_done) {
+        /* The package was cut short, look for the next one. */
+        m_ipd_state = IPD_SCAN;
+        m_ipd_len = 0;
+    }
+    m_sink = NULL;
+    m_sink_done = false;
+    
+    if (data_len) {
+        *data_len = m_sink_len + m_ipd_len;
+    }
+    if (m_sink_from >= 0 && coming_mux_id) {
+        *coming_mux_id = m_sink_from;
+    }
+    return m_sink_len;
+}
+
+void ESP8266::rx_empty(void) 
+{
+    while(m_puart->available() > 0) {
+        m_puart->read();
+    }
+    RING_ATOMIC {
+        m_ring_tail = m_ring_head;
+    }
+    m_ipd_state = IPD_SCAN;
+    m_ipd_pos = 0;
+    m_line_len = 0;
+}
+
+uint16_t ESP8266::rx_read(uint8_t *buffer, uint16_t len)
+{
+    uint16_t head;
+    uint16_t tail;
+    uint16_t n;
+    
+    if (m_ring == NULL) {
+        return m_uart_read(m_puart, buffer, len);
+    }
+    RING_ATOMIC {
+        head = m_ring_head;
+    }
+    tail = m_ring_tail;
+    if (head == tail) {
+        if (m_passthrough) {
+            /* 
+             * pump holds off from the passthrough command on, so the bytes after 
+             * the prompt stay in the UART for the stream. 
+             */
+            return m_uart_read(m_puart, buffer, len);
+        }
+        /* Pump once the ring is empty rather than for every byte. */
+        if (pump() == 0) {
+            return 0;
+        }
+        RING_ATOMIC {
+            head = m_ring_head;
+        }
+    }
+    /* Only up to the end of the ring: the callers read again while bytes come. */
+    n = (head >= tail ? head : m_ring_size) - tail;
+    if (n > len) {
+        n = len;
+    }
+    memcpy(buffer, m_ring + tail, n);
+    tail += n;
+    if (tail == m_ring_size) {
+        tail = 0;
+    }
+    RING_ATOMIC {
+        m_ring_tail = tail;
+    }
+    return n;
+}
+
+void ESP8266::waitStep(void)
+{
+    poll();
+    if (m_idle_cb) {
+        m_idle_cb(m_idle_arg);
+    }
+}
+
+void ESP8266::rx_dispatch(void)
+{
+    uint8_t c;
+    
+    STATS(if (m_puart->available() >= RX_FULL) statsCount(&m_stats.rx_full));
+    for (;;) {
+        if (m_ipd_state == IPD_DATA) {
+            if (!rx_payload()) {
+                return;
+            }
+        } else if (rx_read(&c, 1) > 0) {
+            rx_byte(c);
+        } else {
+            return;
+        }
+        if (m_sink_done || (m_passthrough && m_cmd == ESP8266_CMD_NONE)) {
+            return;
+        }
+    }
+}
+
+/* Bytes of the payload left, as many as one read can take. */
+static uint16_t rx_want(uint32_t left, uint32_t room)
+{
+    if (room > left) {
+        room = left;
+    }
+    return room > 0xFFFF ? 0xFFFF : room;
+}
+
+bool ESP8266::rx_payload(void)
+{
+    uint8_t chunk[32];
+    uint8_t id = m_ipd_id < 0 ? 0 : m_ipd_id;
+    uint16_t n;
+    LinkBuffer *link;
+    uint16_t tail;
+    bool to_cb = false;
+    
+    if (m_sink && (m_sink_id < 0 || m_ipd_id < 0 || m_ipd_id == m_sink_id)) {
+        m_sink_from = m_ipd_id;
+        n = rx_read(m_sink + m_sink_len, rx_want(m_ipd_len, m_sink_size - m_sink_len));
+        m_sink_len += n;
+        m_ipd_len -= n;
+        if (m_ipd_len == 0 || m_sink_len == m_sink_size) {
+            /* The rest of the package, if any, is kept for the next call. */
+            m_sink_done = true;
+        }
+    } else if (m_data_cb) {
+        n = rx_read(chunk, rx_want(m_ipd_len, sizeof(chunk)));
+        m_ipd_len -= n;
+        to_cb = true;
+    } else {
+        link = &m_link[id];
+        if (link->count < link->size) {
+            /* Up to the end of the free space or of the buffer, whichever comes first. */
+            tail = (link->head + link->count) % link->size;
+            n = tail < link->head ? link->head - tail : link->size - tail;
+            n = rx_read(link->buffer + tail, rx_want(m_ipd_len, n));
+            link->count += n;
+        } else {
+            n = rx_read(chunk, rx_want(m_ipd_len, sizeof(chunk)));
+            link->overflow += n;
+            STATS(m_stats.dropped += n);
+            if (n > 0) {
+                TRACE_ERROR(ESP8266_TRACE_DROP, id, n);
+            }
+        }
+        m_ipd_len -= n;
+    }
+    STATS(m_stats.received[id] += n);
+    if (m_ipd_len == 0) {
+        m_ipd_state = IPD_SCAN;
+    }
+    if (to_cb && n > 0) {
+        m_data_cb(id, chunk, n, m_data_arg);
+    }
+    return n > 0;
+}
+
+void ESP8266::rx_byte(char c)
+{
+    if (c == '\0') {
+        return;
+    }
+    if (ipdStep(c)) {
+        m_line_len = 0;
+        return;
+    }
+    if (m_fld_end) {
+        fieldStep(c);
+    }
+    if (m_cmd != ESP8266_CMD_NONE) {
+        cmdStep(c);
+    }
+    if (c == '\n') {
+        rx_line();
+        m_line_len = 0;
+    } else if (c != '\r' && m_line_len < sizeof(m_line)) {
+        m_line[m_line_len++] = c;
+    }
+}
+
+/* event is in flash */
+static bool lineIs(const char *line, uint8_t len, const char *event)
+{
+    return strlen_P(event) == len && memcmp_P(line, event, len) == 0;
+}
+
+/* The decimal number at the beginning of line, *digits long(0 if none). */
+static uint16_t lineNumber(const char *line, uint8_t len, uint8_t *digits)
+{
+    uint16_t value = 0;
+    uint8_t i;
+    
+    for (i = 0; i < len && line[i] >= '0' && line[i] <= '9'; i++) {
+        value = value * 10 + (line[i] - '0');
+    }
+    *digits = i;
+    return value;
+}
+
+/* 
+ * [<id>,]CONNECT, [<id>,]CLOSED, [<id>,]CONNECT FAIL, <id>,<segment id>,SEND OK|FAIL, 
+ * WIFI ..., ready and "we must restart" 
+ */
+void ESP8266::rx_line(void)
+{
+    uint8_t wifi;
+    const char *line = m_line;
+    uint8_t len = m_line_len;
+    uint8_t id = 0;
+    uint16_t seg;
+    uint8_t n;
+    uint8_t m;
+    
+    if (m_cmd == ESP8266_CMD_CIPSENDBUF && m_send_state == SEND_PROMPT) {
+        /* <segment id>,<segment id sent> before the prompt */
+        seg = lineNumber(line, len, &n);
+        if (n > 0 && n < len && line[n] == ',') {
+            lineNumber(line + n + 1, len - n - 1, &m);
+            if (m > 0 && n + 1 + m == len) {
+                m_send_seg_id = seg;
+                return;
+            }
+        }
+    }
+    if (m_cmd == ESP8266_CMD_CIPSERVER && len >= 12 && memcmp_P(line + len - 12, PSTR("must restart"), 12) == 0) {
+        /* 0.9.x: "we must restart" instead of OK or ERROR. */
+        TRACE_ERROR(ESP8266_TRACE_RX, m_cmd, 2);
+        STATS(statsCount(&m_stats.command[m_cmd].errors));
+        m_must_restart = true;
+        cmdEnd(false);
+        return;
+    }
+    if (len >= 2 && line[0] >= '0' && line[0] <= '4' && line[1] == ',') {
+        id = line[0] - '0';
+        line += 2;
+        len -= 2;
+    }
+    if (lineIs(line, len, PSTR("CONNECT"))) {
+        m_events |= ESP8266_EVENT_CONNECT;
+        TRACE_INFO(ESP8266_TRACE_LINK, id, 1);
+        linkReset(id, true);
+        windowReset(id, false);
+        if (m_link_cb) {
+            m_link_cb(id, true, m_link_arg);
+        }
+        return;
+    }
+    if (lineIs(line, len, PSTR("CLOSED")) || lineIs(line, len, PSTR("CONNECT FAIL"))) {
+        m_events |= ESP8266_EVENT_CLOSED;
+        TRACE_INFO(ESP8266_TRACE_LINK, id, 0);
+        linkReset(id, false);
+        windowReset(id, true);
+        if (m_link_cb) {
+            m_link_cb(id, false, m_link_arg);
+        }
+        return;
+    }
+    if (line != m_line) {
+        seg = lineNumber(line, len, &n);
+        if (n > 0 && n < len && line[n] == ',') {
+            if (lineIs(line + n + 1, len - n - 1, PSTR("SEND OK"))) {
+                m_window[id].acked = seg;
+            } else if (lineIs(line + n + 1, len - n - 1, PSTR("SEND FAIL"))) {
+                m_window[id].acked = seg;
+                m_window[id].failed = true;
+            }
+        }
+        return;
+    }
+    if (m_cmd == ESP8266_CMD_CIPSTATUS && len == 8 && memcmp_P(line, PSTR("STATUS:"), 7) == 0) {
+        /* The links listed next are all that are open. */
+        for (id = 0; id < 5; id++) {
+            linkReset(id, false);
+        }
+        return;
+    }
+    if (lineIs(line, len, PSTR("ready"))) {
+        m_events |= ESP8266_EVENT_READY;
+        m_ready = true;
+        for (id = 0; id < 5; id++) {
+            linkReset(id, false);
+            windowReset(id, true);
+        }
+        return;
+    }
+    if (lineIs(line, len, PSTR("WIFI CONNECTED"))) {
+        m_events |= ESP8266_EVENT_WIFI_CONNECTED;
+        wifi = ESP8266_WIFI_CONNECTED;
+    } else if (lineIs(line, len, PSTR("WIFI GOT IP"))) {
+        m_events |= ESP8266_EVENT_WIFI_GOT_IP;
+        wifi = ESP8266_WIFI_GOT_IP;
+    } else if (lineIs(line, len, PSTR("WIFI DISCONNECT"))) {
+        m_events |= ESP8266_EVENT_WIFI_DISCONNECT;
+        wifi = ESP8266_WIFI_DISCONNECTED;
+    } else {
+        return;
+    }
+    TRACE_INFO(ESP8266_TRACE_WIFI, wifi, 0);
+    if (m_wifi_cb) {
+        m_wifi_cb(wifi, m_wifi_arg);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Incremental target matching */
+
+/*
+ * The state of one target is the length of its prefix matched so far. 
+ * Nothing else is kept: on a mismatch the next state is found by sliding 
+ * the target along its own matched prefix (targets are only a few bytes). 
+ * Targets are in flash. 
+ */
+static void matcherInit(ESP8266Matcher *m, const char *target)
+{
+    m->target = target;
+    m->len = target ? strlen_P(target) : 0;
+    m->state = 0;
+}
+
+static bool matcherPrefixAt(const char *target, uint8_t at, uint8_t len)
+{
+    for (uint8_t i = 0; i < len; i++) {
+        if (pgm_read_byte(&target[i]) != pgm_read_byte(&target[at + i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool matcherStep(ESP8266Matcher *m, char c)
+{
+    uint8_t k;
+    
+    if (m->len == 0) {
+        return false;
+    }
+    if ((char)pgm_read_byte(&m->target[m->state]) == c) {
+        m->state++;
+    } else {
+        for (k = m->state; k > 0; k--) {
+            /* Longest prefix of length k that ends with c */
+            if ((char)pgm_read_byte(&m->target[k - 1]) == c 
+                && matcherPrefixAt(m->target, m->state - k + 1, k - 1)) {
+                break;
+            }
+        }
+        m->state = k;
+    }
+    if (m->state == m->len) {
+        m->state = 0;
+        return true;
+    }
+    return false;
+}
+
+/*----------------------------------------------------------------------------*/
+/* Records of a response: <prefix><field>,"<field>",...<end> */
+
+void ESP8266::fieldBegin(const char *prefix, char end)
+{
+    matcherInit(&m_fld_prefix, prefix);
+    m_fld_end = end;
+    m_fld_index = -1;
+}
+
+void ESP8266::fieldStep(char c)
+{
+    if (m_fld_index < 0) {
+        if (matcherStep(&m_fld_prefix, c)) {
+            memset(&m_fld, 0, sizeof(m_fld));
+            m_fld_index = 0;
+            m_fld_pos = 0;
+            m_fld_num = 0;
+            m_fld_neg = false;
+            m_fld_quoted = false;
+        }
+        return;
+    }
+    if ((c == '\r' || c == '\n') && c != m_fld_end) {
+        /* Cut short, wait for the next one. */
+        m_fld_index = -1;
+        return;
+    }
+    if (c == '"') {
+        m_fld_quoted = !m_fld_quoted;
+        return;
+    }
+    if (m_fld_quoted || (c != ',' && c != m_fld_end)) {
+        if (m_cmd == ESP8266_CMD_CWLAP) {
+            apChar(c);
+        } else {
+            linkChar(c);
+        }
+        return;
+    }
+    if (m_cmd == ESP8266_CMD_CWLAP) {
+        apField();
+    } else {
+        linkField();
+    }
+    if (c == m_fld_end) {
+        m_fld_index = -1;
+        if (m_cmd == ESP8266_CMD_CWLAP) {
+            m_ap_cb(&m_fld.ap, m_ap_arg);
+        } else {
+            linkRecord();
+        }
+        return;
+    }
+    if (m_fld_index < 15) {
+        m_fld_index++;
+    }
+    m_fld_pos = 0;
+    m_fld_num = 0;
+    m_fld_neg = false;
+}
+
+/* Which field the n-th one listed is, from the mask of AT+CWLAPOPT. */
+static uint8_t apKind(uint16_t mask, int8_t n)
+{
+    for (uint8_t bit = 0; bit < 16; bit++) {
+        if ((mask & (1 << bit)) && n-- == 0) {
+            return bit <= AP_CH ? bit : AP_NONE;
+        }
+    }
+    return AP_NONE;
+}
+
+/* Digits and '-' of a number field. */
+static void fieldNumber(char c, int32_t *num, bool *neg)
+{
+    if (c == '-') {
+        *neg = true;
+    } else if (c >= '0' && c <= '9' && *num < 100000) {
+        *num = *num * 10 + (c - '0');
+    }
+}
+
+/* The value of a hex digit, -1 for any other character. */
+static int8_t hexValue(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    } else if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    } else if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+void ESP8266::apChar(char c)
+{
+    ESP8266AP *ap = &m_fld.ap;
+    int8_t v;
+    
+    switch (apKind(m_ap_mask, m_fld_index)) {
+    case AP_SSID:
+        if (m_fld_pos < sizeof(ap->ssid) - 1) {
+            ap->ssid[m_fld_pos++] = c;
+        }
+        break;
+    case AP_MAC:
+        v = hexValue(c);
+        if (v < 0) {
             break;
         }
+        if (m_fld_pos < 2 * sizeof(ap->mac)) {
+            ap->mac[m_fld_pos / 2] = (ap->mac[m_fld_pos / 2] << 4) | v;
+            m_fld_pos++;
+        }
+        break;
+    default:
+        fieldNumber(c, &m_fld_num, &m_fld_neg);
+        break;
     }
-    return data;
 }
 
-bool ESP8266::recvFind(String target, uint32_t timeout)
+void ESP8266::apField(void)
 {
-    String data_tmp;
-    data_tmp = recvString(target, timeout);
-    if (data_tmp.indexOf(target) != -1) {
-        return true;
+    int32_t num = m_fld_neg ? -m_fld_num : m_fld_num;
+    
+    switch (apKind(m_ap_mask, m_fld_index)) {
+    case AP_ECN:
+        m_fld.ap.ecn = num;
+        break;
+    case AP_RSSI:
+        m_fld.ap.rssi = num;
+        break;
+    case AP_CH:
+        m_fld.ap.channel = num;
+        break;
     }
-    return false;
 }
 
-bool ESP8266::recvFindAndFilter(String target, String begin, String end, String &data, uint32_t timeout)
+void ESP8266::linkChar(char c)
+{
+    ESP8266LinkStatus *link = &m_fld.link;
+    
+    switch (m_fld_index) {
+    case LINK_TYPE:
+        if (m_fld_pos < sizeof(link->type) - 1) {
+            link->type[m_fld_pos++] = c;
+        }
+        break;
+    case LINK_IP:
+        if (c == '.') {
+            m_fld_pos++;
+        } else if (c >= '0' && c <= '9' && m_fld_pos < sizeof(link->ip)) {
+            link->ip[m_fld_pos] = link->ip[m_fld_pos] * 10 + (c - '0');
+        }
+        break;
+    default:
+        fieldNumber(c, &m_fld_num, &m_fld_neg);
+        break;
+    }
+}
+
+void ESP8266::linkField(void)
+{
+    switch (m_fld_index) {
+    case LINK_ID:
+        m_fld.link.id = m_fld_num;
+        break;
+    case LINK_PORT:
+        m_fld.link.remote_port = m_fld_num;
+        break;
+    case LINK_LOCAL_PORT:
+        m_fld.link.local_port = m_fld_num;
+        break;
+    case LINK_SERVER:
+        m_fld.link.server = m_fld_num == 1;
+        break;
+    }
+}
+
+void ESP8266::linkRecord(void)
+{
+    if (m_fld.link.id < sizeof(m_link_status) / sizeof(m_link_status[0])) {
+        m_fld.link.open = true;
+        m_fld.link.known = true;
+        m_link_status[m_fld.link.id] = m_fld.link;
+    }
+}
+
+void ESP8266::linkReset(uint8_t id, bool open)
+{
+    ESP8266LinkStatus *link = &m_link_status[id];
+    memset(link, 0, sizeof(*link));
+    link->id = id;
+    link->open = open;
+    link->known = !open;
+}
+
+/*----------------------------------------------------------------------------*/
+/* AT command table, kept in flash */
+
+static const char AT_TEXT_AT[] PROGMEM = "AT";
+static const char AT_TEXT_RST[] PROGMEM = "AT+RST";
+static const char AT_TEXT_GMR[] PROGMEM = "AT+GMR";
+static const char AT_TEXT_CWMODE[] PROGMEM = "AT+CWMODE";
+static const char AT_TEXT_CWJAP[] PROGMEM = "AT+CWJAP";
+static const char AT_TEXT_CWLAP[] PROGMEM = "AT+CWLAP";
+static const char AT_TEXT_CWQAP[] PROGMEM = "AT+CWQAP";
+static const char AT_TEXT_CWSAP[] PROGMEM = "AT+CWSAP";
+static const char AT_TEXT_CWLIF[] PROGMEM = "AT+CWLIF";
+static const char AT_TEXT_CIPSTATUS[] PROGMEM = "AT+CIPSTATUS";
+static const char AT_TEXT_CIPSTART[] PROGMEM = "AT+CIPSTART";
+static const char AT_TEXT_CIPSEND[] PROGMEM = "AT+CIPSEND";
+static const char AT_TEXT_CIPCLOSE[] PROGMEM = "AT+CIPCLOSE";
+static const char AT_TEXT_CIFSR[] PROGMEM = "AT+CIFSR";
+static const char AT_TEXT_CIPMUX[] PROGMEM = "AT+CIPMUX";
+static const char AT_TEXT_CIPSERVER[] PROGMEM = "AT+CIPSERVER";
+static const char AT_TEXT_CIPSTO[] PROGMEM = "AT+CIPSTO";
+static const char AT_TEXT_CIPMODE[] PROGMEM = "AT+CIPMODE";
+static const char AT_TEXT_UART[] PROGMEM = "AT+UART_";
+static const char AT_TEXT_CWLAPOPT[] PROGMEM = "AT+CWLAPOPT";
+static const char AT_TEXT_CIPSENDBUF[] PROGMEM = "AT+CIPSENDBUF";
+static const char AT_TEXT_CIPSTA[] PROGMEM = "AT+CIPSTA";
+static const char AT_TEXT_CWDHCP[] PROGMEM = "AT+CWDHCP";
+static const char AT_TEXT_CIPDOMAIN[] PROGMEM = "AT+CIPDOMAIN";
+
+static const char AT_OK[] PROGMEM = "OK";
+static const char AT_ERROR[] PROGMEM = "ERROR";
+static const char AT_FAIL[] PROGMEM = "FAIL";
+static const char AT_NO_CHANGE[] PROGMEM = "no change";
+static const char AT_ALREADY_CONNECT[] PROGMEM = "ALREADY CONNECT";
+static const char AT_LINK_IS_NOT[] PROGMEM = "link is not";
+static const char AT_LINK_IS_BUILDED[] PROGMEM = "Link is builded";
+static const char AT_PROMPT[] PROGMEM = ">";
+static const char AT_SEND_OK[] PROGMEM = "SEND OK";
+static const char AT_SEND_FAIL[] PROGMEM = "SEND FAIL";
+static const char AT_RECV_BYTES[] PROGMEM = " bytes";
+static const char AT_ECHO_END[] PROGMEM = "\r\r\n";
+static const char AT_LIST_END[] PROGMEM = "\r\n\r\nOK";
+static const char AT_LINE_END[] PROGMEM = "\r\n";
+static const char AT_CWMODE_BEGIN[] PROGMEM = "+CWMODE:";
+static const char AT_CWJAP_BEGIN[] PROGMEM = "+CWJAP:";
+static const char AT_CWLAP_BEGIN[] PROGMEM = "+CWLAP:(";
+static const char AT_CIPSTATUS_BEGIN[] PROGMEM = "+CIPSTATUS:";
+static const char AT_CIPDOMAIN_BEGIN[] PROGMEM = "+CIPDOMAIN:";
+
+struct ATCommand {
+    const char *text;       /* Without parameters */
+    const char *ok;
+    const char *ok2;        /* Another response of success */
+    const char *fail;
+    uint16_t timeout;
+};
+
+/* Indexed by ESP8266_CMD_* */
+static const ATCommand AT_COMMANDS[] PROGMEM = {
+    { NULL,              NULL,      NULL,               NULL,               0 },
+    { AT_TEXT_AT,        AT_OK,     NULL,               AT_ERROR,           1000 },
+    { AT_TEXT_RST,       AT_OK,     NULL,               AT_ERROR,           1000 },
+    { AT_TEXT_GMR,       AT_OK,     NULL,               AT_ERROR,           1000 },
+    { AT_TEXT_CWMODE,    AT_OK,     AT_NO_CHANGE,       AT_ERROR,           1000 },
+    { AT_TEXT_CWJAP,     AT_OK,     NULL,               AT_FAIL,            10000 },
+    { AT_TEXT_CWLAP,     AT_OK,     NULL,               AT_ERROR,           10000 },
+    { AT_TEXT_CWQAP,     AT_OK,     NULL,               AT_ERROR,           1000 },
+    { AT_TEXT_CWSAP,     AT_OK,     NULL,               AT_ERROR,           5000 },
+    { AT_TEXT_CWLIF,     AT_OK,     NULL,               AT_ERROR,           1000 },
+    { AT_TEXT_CIPSTATUS, AT_OK,     NULL,               AT_ERROR,           1000 },
+    { AT_TEXT_CIPSTART,  AT_OK,     AT_ALREADY_CONNECT, AT_ERROR,           10000 },
+    { AT_TEXT_CIPSEND,   AT_PROMPT, NULL,               AT_ERROR,           5000 },
+    { AT_TEXT_CIPCLOSE,  AT_OK,     AT_LINK_IS_NOT,     AT_ERROR,           5000 },
+    { AT_TEXT_CIFSR,     AT_OK,     NULL,               AT_ERROR,           1000 },
+    { AT_TEXT_CIPMUX,    AT_OK,     NULL,               AT_LINK_IS_BUILDED, 1000 },
+    { AT_TEXT_CIPSERVER, AT_OK,     AT_NO_CHANGE,       AT_ERROR,           1000 },
+    { AT_TEXT_CIPSTO,    AT_OK,     NULL,               AT_ERROR,           1000 },
+    { AT_TEXT_CIPMODE,   AT_OK,     NULL,               AT_ERROR,           1000 },
+    { AT_TEXT_UART,      AT_OK,     NULL,               AT_ERROR,           1000 },
+    { AT_TEXT_CWLAPOPT,  AT_OK,     NULL,               AT_ERROR,           1000 },
+    { AT_TEXT_CIPSENDBUF, AT_PROMPT, NULL,              AT_ERROR,           5000 },
+    { AT_TEXT_CIPSTA,    AT_OK,     NULL,               AT_ERROR,           1000 },
+    { AT_TEXT_CWDHCP,    AT_OK,     NULL,               AT_ERROR,           1000 },
+    { AT_TEXT_CIPDOMAIN, AT_OK,     NULL,               AT_ERROR,           10000 },
+};
+
+/*----------------------------------------------------------------------------*/
+/* Command in progress */
+
+void ESP8266::cmdBegin(uint8_t cmd)
+{
+    ATCommand at;
+    
+    cmdWait();
+    /* What came since the last command is not its response, but events and data. */
+    rx_dispatch();
+    memcpy_P(&at, &AT_COMMANDS[cmd], sizeof(at));
+    TRACE_INFO(ESP8266_TRACE_TX, cmd, 0);
+    m_cmd = cmd;
+    m_cmd_ok = false;
+    STATS(m_stats_start = millis());
+    m_cmd_filter = CMD_FILTER_NONE;
+    m_cmd_data = NULL;
+    m_send_state = SEND_NONE;
+    cmdExpect(at.ok, at.ok2, at.fail, at.timeout);
+    m_puart->print((const __FlashStringHelper *)at.text);
+}
+
+void ESP8266::cmdExpect(const char *ok, const char *ok2, const char *fail, uint32_t timeout)
+{
+    matcherInit(&m_cmd_target[0], ok);
+    matcherInit(&m_cmd_target[1], ok2);
+    matcherInit(&m_cmd_target[2], fail);
+    m_cmd_timeout = timeout;
+    m_cmd_start = millis();
+}
+
+void ESP8266::cmdFilter(const char *begin, const char *end, String *data)
+{
+    matcherInit(&m_cmd_begin, begin);
+    matcherInit(&m_cmd_end, end);
+    m_cmd_filter = CMD_FILTER_WAIT;
+    m_cmd_data = data;
+    *data = "";
+}
+
+void ESP8266::cmdStep(char c)
+{
+    uint8_t i;
+    
+    if (m_cmd_filter == CMD_FILTER_COPY) {
+        *m_cmd_data += c;
+        if (matcherStep(&m_cmd_end, c)) {
+            m_cmd_data->remove(m_cmd_data->length() - m_cmd_end.len);
+            m_cmd_filter = CMD_FILTER_DONE;
+        }
+    } else if (m_cmd_filter == CMD_FILTER_WAIT && matcherStep(&m_cmd_begin, c)) {
+        m_cmd_filter = CMD_FILTER_COPY;
+    }
+    
+    for (i = 0; i < 3; i++) {
+        /* A target inside the captured text or a record being parsed does not end the response. */
+        if (!matcherStep(&m_cmd_target[i], c) || m_cmd_filter == CMD_FILTER_COPY || m_fld_index >= 0) {
+            continue;
+        }
+        if (i == 2) {
+            TRACE_ERROR(ESP8266_TRACE_RX, m_cmd, i);
+        } else {
+            TRACE_INFO(ESP8266_TRACE_RX, m_cmd, i);
+        }
+        if (i == 0 && m_send_state == SEND_PROMPT) {
+            sendPayload();
+            return;
+        }
+        if (i == 0 && m_send_state == SEND_RESULT && m_send_len > 0) {
+            /* Go on with the next package as soon as this one is sent. */
+            m_puart->print((const __FlashStringHelper *)AT_TEXT_CIPSEND);
+            sendHeader();
+            return;
+        }
+        STATS(if (i == 2) statsCount(&m_stats.command[m_cmd].errors));
+        cmdEnd(i < 2 && m_cmd_filter != CMD_FILTER_WAIT && !m_send_short);
+        return;
+    }
+}
+
+void ESP8266::cmdEnd(bool success)
+{
+    uint8_t cmd = m_cmd;
+    
+    STATS(statsCount(&m_stats.command[cmd].count),
+          statsCount(&m_stats.command[cmd].latency[statsBucket(millis() - m_stats_start)]));
+    if (!success && m_cmd_data) {
+        *m_cmd_data = "";
+    }
+#if ESP8266_DNS_CACHE > 0
+    if (cmd == ESP8266_CMD_CIPSTART && m_dns_used >= 0) {
+        if (!success) {
+            /* The host may have moved: look it up again next time. */
+            m_dns[m_dns_used].name[0] = '\0';
+        }
+        m_dns_used = -1;
+    }
+#endif
+    if (m_seq_sent) {
+        m_seq->ok = success;
+        m_seq->time = millis() - m_seq_start;
+        m_seq_sent = false;
+        m_seq = success && --m_seq_left > 0 ? m_seq + 1 : NULL;
+    }
+    if (success && cmd == ESP8266_CMD_CIPSENDBUF) {
+        /* Before its SEND OK can be read. */
+        m_window[m_send_mux].queued = m_send_seg_id ? m_send_seg_id : m_window[m_send_mux].queued + 1;
+    }
+    m_cmd = ESP8266_CMD_NONE;
+    m_cmd_ok = success;
+    m_cmd_filter = CMD_FILTER_NONE;
+    m_cmd_data = NULL;
+    m_fld_end = '\0';
+    m_fld_index = -1;
+    m_send_state = SEND_NONE;
+    if (m_cmd_cb) {
+        m_cmd_cb(cmd, success, m_cmd_arg);
+    }
+}
+
+void ESP8266::sendBegin(int8_t mux_id, const ESP8266Segment *segs, uint8_t count, uint8_t cmd)
+{
+    uint8_t i;
+    
+    cmdBegin(cmd);
+    m_send_mux = mux_id;
+    m_send_seg = segs;
+    m_send_segs = count;
+    m_send_pos = 0;
+    m_send_len = 0;
+    for (i = 0; i < count; i++) {
+        m_send_len += segs[i].len;
+    }
+    m_send_short = false;
+    sendHeader();
+}
+
+void ESP8266::sendBegin(int8_t mux_id, uint8_t type, const void *data, uint32_t len, ESP8266SourceCallback source,
+    uint8_t cmd)
+{
+    m_send_one.type = type;
+    m_send_one.data = data;
+    m_send_one.len = len;
+    m_send_one.source = source;
+    sendBegin(mux_id, &m_send_one, 1, cmd);
+}
+
+bool ESP8266::windowWait(uint8_t mux_id, uint8_t most, unsigned long start, uint32_t timeout)
 {
-    String data_tmp;
-    data_tmp = recvString(target, timeout);
-    if (data_tmp.indexOf(target) != -1) {
-        int32_t index1 = data_tmp.indexOf(begin);
-        int32_t index2 = data_tmp.indexOf(end);
-        if (index1 != -1 && index2 != -1) {
-            index1 += begin.length();
-            data = data_tmp.substring(index1, index2);
+    SendWindow *w = &m_window[mux_id];
+    
+    for (;;) {
+        waitStep();
+        if (w->failed) {
+            return false;
+        }
+        if ((uint16_t)(w->queued - w->acked) <= most) {
             return true;
         }
+        if (!isLinkOpen(mux_id) || millis() - start >= timeout) {
+            return false;
+        }
     }
-    data = "";
-    return false;
+}
+
+void ESP8266::windowReset(uint8_t id, bool closed)
+{
+    SendWindow *w = &m_window[id];
+    w->failed = closed && w->queued != w->acked;
+    w->queued = 0;
+    w->acked = 0;
+}
+
+void ESP8266::sendHeader(void)
+{
+    m_send_pkg = m_send_len < CIPSEND_MAX ? m_send_len : CIPSEND_MAX;
+    TRACE_DEBUG(ESP8266_TRACE_SEND, (uint8_t)m_send_mux, m_send_pkg);
+    m_send_state = SEND_PROMPT;
+    cmdExpect(AT_PROMPT, NULL, AT_ERROR, 5000);
+    
+    m_puart->print('=');
+    if (m_send_mux >= 0) {
+        m_puart->print((uint8_t)m_send_mux);
+        m_puart->print(',');
+    }
+    m_puart->println(m_send_pkg);
+}
+
+void ESP8266::sendPayload(void)
+{
+    uint8_t chunk[SEND_CHUNK];
+    uint32_t left = m_send_pkg;
+    uint32_t n;
+    uint32_t got;
+    const ESP8266Segment *seg;
+    const uint8_t *data;
+    
+    while (left > 0) {
+        seg = m_send_seg;
+        if (m_send_pos == seg->len) {
+            m_send_seg++;
+            m_send_segs--;
+            m_send_pos = 0;
+            continue;
+        }
+        n = seg->len - m_send_pos < left ? seg->len - m_send_pos : left;
+        data = (const uint8_t *)seg->data + m_send_pos;
+        if (seg->type == ESP8266_SEGMENT_RAM) {
+            if (m_idle_cb && n > SEND_CHUNK) {
+                /* Block writes last as long as the bytes take on the line: let the callback run between. */
+                n = SEND_CHUNK;
+            }
+            m_puart->write(data, n);
+        } else {
+            if (n > sizeof(chunk)) {
+                n = sizeof(chunk);
+            }
+            if (seg->type == ESP8266_SEGMENT_FLASH) {
+                memcpy_P(chunk, data, n);
+            } else {
+                got = seg->source(chunk, n, (void *)seg->data);
+                if (got < n) {
+                    /* The length is announced already, fill the package up and give up after it. */
+                    memset(chunk + got, 0, n - got);
+                    m_send_short = true;
+                }
+            }
+            m_puart->write(chunk, n);
+        }
+        m_send_pos += n;
+        left -= n;
+        if (m_idle_cb) {
+            m_idle_cb(m_idle_arg);
+        }
+    }
+    m_send_len = m_send_short ? 0 : m_send_len - m_send_pkg;
+    STATS(m_stats.sent[m_send_mux < 0 ? 0 : m_send_mux] += m_send_pkg);
+    
+    m_send_state = SEND_RESULT;
+    if (m_cmd == ESP8266_CMD_CIPSENDBUF) {
+        /* In the buffer of ESP8266: SEND OK comes later with the segment id. */
+        cmdExpect(AT_RECV_BYTES, NULL, AT_ERROR, 5000);
+    } else {
+        cmdExpect(AT_SEND_OK, NULL, AT_SEND_FAIL, 10000);
+    }
+}
+
+bool ESP8266::cmdWait(void)
+{
+    while (m_cmd != ESP8266_CMD_NONE) {
+        waitStep();
+    }
+    return m_cmd_ok;
 }
 
 bool ESP8266::eAT(void)
 {
-    rx_empty();
-    m_puart->println("AT");
-    return recvFind("OK");
+    cmdBegin(ESP8266_CMD_AT);
+    m_puart->println();
+    return cmdWait();
 }
 
 bool ESP8266::eATRST(void) 
 {
-    rx_empty();
-    m_puart->println("AT+RST");
-    return recvFind("OK");
+    cmdBegin(ESP8266_CMD_RST);
+    m_puart->println();
+    return cmdWait();
 }
 
 bool ESP8266::eATGMR(String &version)
 {
-    rx_empty();
-    m_puart->println("AT+GMR");
-    return recvFindAndFilter("OK", "\r\r\n", "\r\n\r\nOK", version); 
+    cmdBegin(ESP8266_CMD_GMR);
+    cmdFilter(AT_ECHO_END, AT_LIST_END, &version);
+    m_puart->println();
+    return cmdWait();
 }
 
 bool ESP8266::qATCWMODE(uint8_t *mode) 
@@ -491,9 +2191,10 @@ bool ESP8266::qATCWMODE(uint8_t *mode)
     if (!mode) {
         return false;
     }
-    rx_empty();
-    m_puart->println("AT+CWMODE?");
-    ret = recvFindAndFilter("OK", "+CWMODE:", "\r\n\r\nOK", str_mode); 
+    cmdBegin(ESP8266_CMD_CWMODE);
+    cmdFilter(AT_CWMODE_BEGIN, AT_LIST_END, &str_mode);
+    m_puart->println('?');
+    ret = cmdWait();
     if (ret) {
         *mode = (uint8_t)str_mode.toInt();
         return true;
@@ -504,214 +2205,419 @@ bool ESP8266::qATCWMODE(uint8_t *mode)
 
 bool ESP8266::sATCWMODE(uint8_t mode)
 {
-    String data;
-    rx_empty();
-    m_puart->print("AT+CWMODE=");
+    cmdBegin(ESP8266_CMD_CWMODE);
+    m_puart->print('=');
     m_puart->println(mode);
-    
-    data = recvString("OK", "no change");
-    if (data.indexOf("OK") != -1 || data.indexOf("no change") != -1) {
-        return true;
-    }
-    return false;
+    return cmdWait();
 }
 
-bool ESP8266::sATCWJAP(String ssid, String pwd)
+bool ESP8266::sATCWMODECUR(uint8_t mode)
 {
-    String data;
-    rx_empty();
-    m_puart->print("AT+CWJAP=\"");
+    cmdBegin(ESP8266_CMD_CWMODE);
+    cmdExpect(AT_OK, NULL, AT_ERROR, 1000);
+    m_puart->print(F("_CUR="));
+    m_puart->println(mode);
+    return cmdWait();
+}
+
+bool ESP8266::qATCWMODECUR(void)
+{
+    cmdBegin(ESP8266_CMD_CWMODE);
+    cmdExpect(AT_OK, NULL, AT_ERROR, 1000);
+    m_puart->println(F("_CUR?"));
+    return cmdWait();
+}
+
+bool ESP8266::sATCWJAPCUR(const String &ssid, const String &pwd, const uint8_t *bssid)
+{
+    static const char hex[] PROGMEM = "0123456789abcdef";
+    
+    cmdBegin(ESP8266_CMD_CWJAP);
+    m_puart->print(F("_CUR=\""));
     m_puart->print(ssid);
-    m_puart->print("\",\"");
+    m_puart->print(F("\",\""));
     m_puart->print(pwd);
-    m_puart->println("\"");
+    m_puart->print(F("\",\""));
+    for (uint8_t i = 0; i < 6; i++) {
+        if (i > 0) {
+            m_puart->print(':');
+        }
+        m_puart->print((char)pgm_read_byte(&hex[bssid[i] >> 4]));
+        m_puart->print((char)pgm_read_byte(&hex[bssid[i] & 0x0F]));
+    }
+    m_puart->println('"');
+    return cmdWait();
+}
+
+/* +CWJAP:"<ssid>","<bssid>",<channel>,<rssi> */
+bool ESP8266::qATCWJAP(ESP8266JoinCache *cache)
+{
+    String info;
+    int at;
+    int8_t hi;
+    int8_t lo;
     
-    data = recvString("OK", "FAIL", 10000);
-    if (data.indexOf("OK") != -1) {
-        return true;
+    cmdBegin(ESP8266_CMD_CWJAP);
+    cmdExpect(AT_OK, NULL, AT_ERROR, 1000);
+    cmdFilter(AT_CWJAP_BEGIN, AT_LINE_END, &info);
+    m_puart->println('?');
+    if (!cmdWait()) {
+        return false;
     }
-    return false;
+    at = info.indexOf(F("\",\""));
+    if (at < 0 || info.length() < (unsigned)at + 3 + 17 + 2) {
+        return false;
+    }
+    at += 3;
+    for (uint8_t i = 0; i < 6; i++, at += 3) {
+        hi = hexValue(info[at]);
+        lo = hexValue(info[at + 1]);
+        if (hi < 0 || lo < 0) {
+            return false;
+        }
+        cache->bssid[i] = (hi << 4) | lo;
+    }
+    cache->channel = info.substring(at + 1).toInt();
+    return true;
+}
+
+bool ESP8266::sATCIPSTACUR(const uint8_t *ip, const uint8_t *gateway, const uint8_t *netmask)
+{
+    cmdBegin(ESP8266_CMD_CIPSTA);
+    m_puart->print(F("_CUR="));
+    printIP(m_puart, ip);
+    m_puart->print(',');
+    printIP(m_puart, gateway);
+    m_puart->print(',');
+    printIP(m_puart, netmask);
+    m_puart->println();
+    return cmdWait();
+}
+
+/* +CIPSTA:ip:"<ip>" +CIPSTA:gateway:"<gateway>" +CIPSTA:netmask:"<netmask>" */
+bool ESP8266::qATCIPSTA(ESP8266JoinCache *cache)
+{
+    String list;
+    
+    cmdBegin(ESP8266_CMD_CIPSTA);
+    cmdFilter(AT_ECHO_END, AT_LIST_END, &list);
+    m_puart->println('?');
+    return cmdWait() && parseIP(list, F("ip:\""), cache->ip)
+        && parseIP(list, F("gateway:\""), cache->gateway)
+        && parseIP(list, F("netmask:\""), cache->netmask);
+}
+
+bool ESP8266::sATCWDHCPCUR(bool enable)
+{
+    cmdBegin(ESP8266_CMD_CWDHCP);
+    m_puart->print(F("_CUR=1,"));
+    m_puart->println(enable ? 1 : 0);
+    return cmdWait();
+}
+
+/* +CIPDOMAIN:<ip> */
+bool ESP8266::sATCIPDOMAIN(const String &host, uint8_t *ip)
+{
+    String info;
+    
+    cmdBegin(ESP8266_CMD_CIPDOMAIN);
+    cmdFilter(AT_CIPDOMAIN_BEGIN, AT_LINE_END, &info);
+    m_puart->print(F("=\""));
+    m_puart->print(host);
+    m_puart->println('"');
+    return cmdWait() && parseIP(info, NULL, ip);
+}
+
+#if ESP8266_DNS_CACHE > 0
+int8_t ESP8266::dnsFind(const String &host, bool lookup)
+{
+    int8_t free = 0;
+    uint8_t ip[4];
+    
+    if (m_dns_ttl == 0 || host.length() > ESP8266_DNS_NAME_MAX || isNumericHost(host)) {
+        return -1;
+    }
+    for (uint8_t i = 0; i < ESP8266_DNS_CACHE; i++) {
+        DNSEntry *e = &m_dns[i];
+        if (e->name[0] != '\0' && millis() - e->time >= m_dns_ttl) {
+            e->name[0] = '\0';
+        }
+        if (e->name[0] != '\0' && host.equals(e->name)) {
+            return i;
+        }
+        /* An unused entry, else the oldest. */
+        if (m_dns[free].name[0] != '\0'
+            && (e->name[0] == '\0' || millis() - e->time > millis() - m_dns[free].time)) {
+            free = i;
+        }
+    }
+    /* The entry is only replaced once the lookup succeeds: it may still be valid. */
+    if (!lookup || !sATCIPDOMAIN(host, ip)) {
+        return -1;
+    }
+    memcpy(m_dns[free].ip, ip, 4);
+    host.toCharArray(m_dns[free].name, sizeof(m_dns[free].name));
+    m_dns[free].time = millis();
+    return free;
+}
+#endif
+
+bool ESP8266::sATCWJAP(const String &ssid, const String &pwd)
+{
+    cmdBegin(ESP8266_CMD_CWJAP);
+    m_puart->print(F("=\""));
+    m_puart->print(ssid);
+    m_puart->print(F("\",\""));
+    m_puart->print(pwd);
+    m_puart->println('"');
+    return true;
 }
 
 bool ESP8266::eATCWLAP(String &list)
 {
-    String data;
-    rx_empty();
-    m_puart->println("AT+CWLAP");
-    return recvFindAndFilter("OK", "\r\r\n", "\r\n\r\nOK", list, 10000);
+    cmdBegin(ESP8266_CMD_CWLAP);
+    cmdFilter(AT_ECHO_END, AT_LIST_END, &list);
+    m_puart->println();
+    return cmdWait();
+}
+
+bool ESP8266::sATCWLAP(ESP8266APCallback cb, void *arg, const char *ssid)
+{
+    cmdBegin(ESP8266_CMD_CWLAP);
+    m_ap_cb = cb;
+    m_ap_arg = arg;
+    fieldBegin(AT_CWLAP_BEGIN, ')');
+    if (ssid) {
+        m_puart->print(F("=\""));
+        m_puart->print(ssid);
+        m_puart->println('"');
+    } else {
+        m_puart->println();
+    }
+    return cmdWait();
+}
+
+bool ESP8266::sATCWLAPOPT(bool sort, uint16_t mask)
+{
+    cmdBegin(ESP8266_CMD_CWLAPOPT);
+    m_puart->print('=');
+    m_puart->print(sort ? 1 : 0);
+    m_puart->print(',');
+    m_puart->println(mask);
+    return cmdWait();
 }
 
 bool ESP8266::eATCWQAP(void)
 {
-    String data;
-    rx_empty();
-    m_puart->println("AT+CWQAP");
-    return recvFind("OK");
+    cmdBegin(ESP8266_CMD_CWQAP);
+    m_puart->println();
+    return cmdWait();
 }
 
-bool ESP8266::sATCWSAP(String ssid, String pwd, uint8_t chl, uint8_t ecn)
+bool ESP8266::sATCWSAP(const String &ssid, const String &pwd, uint8_t chl, uint8_t ecn)
 {
-    String data;
-    rx_empty();
-    m_puart->print("AT+CWSAP=\"");
+    cmdBegin(ESP8266_CMD_CWSAP);
+    m_puart->print(F("=\""));
     m_puart->print(ssid);
-    m_puart->print("\",\"");
+    m_puart->print(F("\",\""));
     m_puart->print(pwd);
-    m_puart->print("\",");
+    m_puart->print(F("\","));
     m_puart->print(chl);
-    m_puart->print(",");
+    m_puart->print(',');
     m_puart->println(ecn);
-    
-    data = recvString("OK", "ERROR", 5000);
-    if (data.indexOf("OK") != -1) {
-        return true;
-    }
-    return false;
+    return cmdWait();
 }
 
 bool ESP8266::eATCWLIF(String &list)
 {
-    String data;
-    rx_empty();
-    m_puart->println("AT+CWLIF");
-    return recvFindAndFilter("OK", "\r\r\n", "\r\n\r\nOK", list);
+    cmdBegin(ESP8266_CMD_CWLIF);
+    cmdFilter(AT_ECHO_END, AT_LIST_END, &list);
+    m_puart->println();
+    return cmdWait();
+}
+bool ESP8266::eATCIPSTATUS(void)
+{
+    cmdBegin(ESP8266_CMD_CIPSTATUS);
+    fieldBegin(AT_CIPSTATUS_BEGIN, '\r');
+    m_puart->println();
+    return cmdWait();
 }
 bool ESP8266::eATCIPSTATUS(String &list)
 {
-    String data;
-    delay(100);
-    rx_empty();
-    m_puart->println("AT+CIPSTATUS");
-    return recvFindAndFilter("OK", "\r\r\n", "\r\n\r\nOK", list);
+    cmdBegin(ESP8266_CMD_CIPSTATUS);
+    cmdFilter(AT_ECHO_END, AT_LIST_END, &list);
+    fieldBegin(AT_CIPSTATUS_BEGIN, '\r');
+    m_puart->println();
+    return cmdWait();
 }
-bool ESP8266::sATCIPSTARTSingle(String type, String addr, uint32_t port)
+bool ESP8266::sATCIPSTARTSingle(const __FlashStringHelper *type, const String &addr, uint32_t port, bool lookup)
 {
-    String data;
-    rx_empty();
-    m_puart->print("AT+CIPSTART=\"");
+#if ESP8266_DNS_CACHE > 0
+    int8_t entry = dnsFind(addr, lookup);
+    
+    cmdBegin(ESP8266_CMD_CIPSTART);
+    m_dns_used = entry;
+#else
+    int8_t entry = -1;
+    
+    cmdBegin(ESP8266_CMD_CIPSTART);
+#endif
+    m_puart->print(F("=\""));
     m_puart->print(type);
-    m_puart->print("\",\"");
-    m_puart->print(addr);
-    m_puart->print("\",");
+    m_puart->print(F("\","));
+    printHost(addr, entry);
+    m_puart->print(',');
     m_puart->println(port);
-    
-    data = recvString("OK", "ERROR", "ALREADY CONNECT", 10000);
-    if (data.indexOf("OK") != -1 || data.indexOf("ALREADY CONNECT") != -1) {
-        return true;
-    }
-    return false;
+    return true;
 }
-bool ESP8266::sATCIPSTARTMultiple(uint8_t mux_id, String type, String addr, uint32_t port)
+bool ESP8266::sATCIPSTARTMultiple(uint8_t mux_id, const __FlashStringHelper *type, const String &addr, uint32_t port, bool lookup)
 {
-    String data;
-    rx_empty();
-    m_puart->print("AT+CIPSTART=");
+#if ESP8266_DNS_CACHE > 0
+    int8_t entry = dnsFind(addr, lookup);
+    
+    cmdBegin(ESP8266_CMD_CIPSTART);
+    m_dns_used = entry;
+#else
+    int8_t entry = -1;
+    
+    cmdBegin(ESP8266_CMD_CIPSTART);
+#endif
+    m_puart->print('=');
     m_puart->print(mux_id);
-    m_puart->print(",\"");
+    m_puart->print(F(",\""));
     m_puart->print(type);
-    m_puart->print("\",\"");
-    m_puart->print(addr);
-    m_puart->print("\",");
+    m_puart->print(F("\","));
+    printHost(addr, entry);
+    m_puart->print(',');
     m_puart->println(port);
-    
-    data = recvString("OK", "ERROR", "ALREADY CONNECT", 10000);
-    if (data.indexOf("OK") != -1 || data.indexOf("ALREADY CONNECT") != -1) {
-        return true;
+    if (mux_id < 5) {
+        /* Data queued for the old link is stale. */
+        m_link[mux_id].head = 0;
+        m_link[mux_id].count = 0;
     }
-    return false;
+    return true;
+}
+void ESP8266::printHost(const String &addr, int8_t entry)
+{
+#if ESP8266_DNS_CACHE > 0
+    if (entry >= 0) {
+        printIP(m_puart, m_dns[entry].ip);
+        return;
+    }
+#endif
+    m_puart->print('"');
+    m_puart->print(addr);
+    m_puart->print('"');
 }
 bool ESP8266::sATCIPSENDSingle(const uint8_t *buffer, uint32_t len)
 {
-    rx_empty();
-    m_puart->print("AT+CIPSEND=");
-    m_puart->println(len);
-    if (recvFind(">", 5000)) {
-        rx_empty();
-        for (uint32_t i = 0; i < len; i++) {
-            m_puart->write(buffer[i]);
-        }
-        return recvFind("SEND OK", 10000);
+    if (buffer == NULL) {
+        return false;
     }
-    return false;
+    sendBegin(-1, ESP8266_SEGMENT_RAM, buffer, len, NULL);
+    return true;
 }
 bool ESP8266::sATCIPSENDMultiple(uint8_t mux_id, const uint8_t *buffer, uint32_t len)
 {
-    rx_empty();
-    m_puart->print("AT+CIPSEND=");
-    m_puart->print(mux_id);
-    m_puart->print(",");
-    m_puart->println(len);
-    if (recvFind(">", 5000)) {
-        rx_empty();
-        for (uint32_t i = 0; i < len; i++) {
-            m_puart->write(buffer[i]);
-        }
-        return recvFind("SEND OK", 10000);
+    if (buffer == NULL) {
+        return false;
     }
-    return false;
+    sendBegin(mux_id, ESP8266_SEGMENT_RAM, buffer, len, NULL);
+    return true;
+}
+bool ESP8266::sATCIPSENDBUF(uint8_t mux_id, const uint8_t *buffer, uint32_t len)
+{
+    if (buffer == NULL || len > CIPSEND_MAX) {
+        return false;
+    }
+    m_send_seg_id = 0;
+    sendBegin(mux_id, ESP8266_SEGMENT_RAM, buffer, len, NULL, ESP8266_CMD_CIPSENDBUF);
+    return true;
 }
 bool ESP8266::sATCIPCLOSEMulitple(uint8_t mux_id)
 {
-    String data;
-    rx_empty();
-    m_puart->print("AT+CIPCLOSE=");
+    cmdBegin(ESP8266_CMD_CIPCLOSE);
+    m_puart->print('=');
     m_puart->println(mux_id);
-    
-    data = recvString("OK", "link is not", 5000);
-    if (data.indexOf("OK") != -1 || data.indexOf("link is not") != -1) {
-        return true;
-    }
-    return false;
+    return true;
 }
 bool ESP8266::eATCIPCLOSESingle(void)
 {
-    rx_empty();
-    m_puart->println("AT+CIPCLOSE");
-    return recvFind("OK", 5000);
+    cmdBegin(ESP8266_CMD_CIPCLOSE);
+    m_puart->println();
+    return true;
 }
 bool ESP8266::eATCIFSR(String &list)
 {
-    rx_empty();
-    m_puart->println("AT+CIFSR");
-    return recvFindAndFilter("OK", "\r\r\n", "\r\n\r\nOK", list);
+    cmdBegin(ESP8266_CMD_CIFSR);
+    cmdFilter(AT_ECHO_END, AT_LIST_END, &list);
+    m_puart->println();
+    return cmdWait();
 }
 bool ESP8266::sATCIPMUX(uint8_t mode)
 {
-    String data;
-    rx_empty();
-    m_puart->print("AT+CIPMUX=");
+    cmdBegin(ESP8266_CMD_CIPMUX);
+    m_puart->print('=');
     m_puart->println(mode);
-    
-    data = recvString("OK", "Link is builded");
-    if (data.indexOf("OK") != -1) {
-        return true;
-    }
-    return false;
+    return cmdWait();
 }
 bool ESP8266::sATCIPSERVER(uint8_t mode, uint32_t port)
 {
-    String data;
+    cmdBegin(ESP8266_CMD_CIPSERVER);
     if (mode) {
-        rx_empty();
-        m_puart->print("AT+CIPSERVER=1,");
+        m_puart->print(F("=1,"));
         m_puart->println(port);
-        
-        data = recvString("OK", "no change");
-        if (data.indexOf("OK") != -1 || data.indexOf("no change") != -1) {
-            return true;
-        }
-        return false;
     } else {
-        rx_empty();
-        m_puart->println("AT+CIPSERVER=0");
-        return recvFind("\r\r\n");
+        m_must_restart = false;
+        m_puart->println(F("=0"));
     }
+    return cmdWait();
 }
 bool ESP8266::sATCIPSTO(uint32_t timeout)
 {
-    rx_empty();
-    m_puart->print("AT+CIPSTO=");
+    cmdBegin(ESP8266_CMD_CIPSTO);
+    m_puart->print('=');
     m_puart->println(timeout);
-    return recvFind("OK");
+    return cmdWait();
+}
+void ESP8266::seqNext(void)
+{
+    cmdBegin(m_seq->command);
+    if (m_seq->response) {
+        cmdFilter(AT_ECHO_END, AT_LIST_END, m_seq->response);
+    }
+    if (m_seq->params) {
+        m_puart->print(m_seq->params);
+    }
+    m_puart->println();
+    m_seq_sent = true;
+    m_seq_start = millis();
+}
+bool ESP8266::sATCIPMODE(uint8_t mode)
+{
+    cmdBegin(ESP8266_CMD_CIPMODE);
+    m_puart->print('=');
+    m_puart->println(mode);
+    return cmdWait();
+}
+bool ESP8266::eATCIPSENDPassthrough(void)
+{
+    cmdBegin(ESP8266_CMD_CIPSEND);
+    /* Reading stops at the prompt, what follows is for the stream. */
+    m_passthrough = true;
+    m_puart->println();
+    if (!cmdWait()) {
+        m_passthrough = false;
+        return false;
+    }
+    return true;
+}
+bool ESP8266::sATUART(uint32_t baud, bool persistent)
+{
+    cmdBegin(ESP8266_CMD_UART);
+    m_puart->print(persistent ? F("DEF=") : F("CUR="));
+    m_puart->print(baud);
+    m_puart->println(F(",8,1,0,0"));
+    return cmdWait();
 }
 
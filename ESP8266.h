@@ -24,7 +24,56 @@
 #include "Arduino.h"
 
 
+/*
+ * Only includes SoftwareSerial.h now, for sketches written for older versions: 
+ * any UART type can be given to the constructor. 
+ */
 //#define ESP8266_USE_SOFTWARE_SERIAL
+//#define ESP8266_USE_STATS
+
+/*
+ * What is recorded in the trace ring, see dumpTrace: 
+ *  0 - nothing, tracing is compiled out(default). 
+ *  1 - timeouts, failures and data abandoned. 
+ *  2 - also commands sent, their results and connection and Wi-Fi events. 
+ *  3 - also +IPD headers and AT+CIPSEND packages. 
+ */
+#ifndef ESP8266_TRACE_LEVEL
+#define ESP8266_TRACE_LEVEL     (0)
+#endif
+
+/*
+ * Entries kept by the trace ring(a power of 2, 8 bytes each). 
+ */
+#ifndef ESP8266_TRACE_SIZE
+#define ESP8266_TRACE_SIZE      (32)
+#endif
+#if ESP8266_TRACE_SIZE < 1 || ESP8266_TRACE_SIZE > 32768 \
+    || (ESP8266_TRACE_SIZE & (ESP8266_TRACE_SIZE - 1)) != 0
+#error "ESP8266_TRACE_SIZE must be a power of 2 from 1 to 32768"
+#endif
+
+/*
+ * Packages of sendBuffered a link may have in ESP8266 not sent yet. 
+ */
+#ifndef ESP8266_SEND_WINDOW
+#define ESP8266_SEND_WINDOW     (4)
+#endif
+
+/*
+ * Host names whose address the driver keeps, see setDNSCacheTTL(0 leaves the 
+ * cache out: ESP8266 looks each name up). 
+ */
+#ifndef ESP8266_DNS_CACHE
+#define ESP8266_DNS_CACHE       (4)
+#endif
+
+/*
+ * Longest host name kept(longer ones are looked up by ESP8266 each time). 
+ */
+#ifndef ESP8266_DNS_NAME_MAX
+#define ESP8266_DNS_NAME_MAX    (31)
+#endif
 
 
 #ifdef ESP8266_USE_SOFTWARE_SERIAL
@@ -32,33 +81,281 @@
 #endif
 
 
+/**
+ * AT commands, as reported to the command callback. 
+ */
+enum ESP8266Command {
+    ESP8266_CMD_NONE = 0,
+    ESP8266_CMD_AT,
+    ESP8266_CMD_RST,
+    ESP8266_CMD_GMR,
+    ESP8266_CMD_CWMODE,
+    ESP8266_CMD_CWJAP,
+    ESP8266_CMD_CWLAP,
+    ESP8266_CMD_CWQAP,
+    ESP8266_CMD_CWSAP,
+    ESP8266_CMD_CWLIF,
+    ESP8266_CMD_CIPSTATUS,
+    ESP8266_CMD_CIPSTART,
+    ESP8266_CMD_CIPSEND,
+    ESP8266_CMD_CIPCLOSE,
+    ESP8266_CMD_CIFSR,
+    ESP8266_CMD_CIPMUX,
+    ESP8266_CMD_CIPSERVER,
+    ESP8266_CMD_CIPSTO,
+    ESP8266_CMD_CIPMODE,
+    ESP8266_CMD_UART,
+    ESP8266_CMD_CWLAPOPT,
+    ESP8266_CMD_CIPSENDBUF,
+    ESP8266_CMD_CIPSTA,
+    ESP8266_CMD_CWDHCP,
+    ESP8266_CMD_CIPDOMAIN,
+    ESP8266_CMD_COUNT,          /* Not a command: the number of them */
+};
+
+/**
+ * Station states, as reported to the Wi-Fi callback. 
+ */
+enum ESP8266WiFiState {
+    ESP8266_WIFI_DISCONNECTED = 0,
+    ESP8266_WIFI_CONNECTED,
+    ESP8266_WIFI_GOT_IP,
+};
+
+/**
+ * Unsolicited results from ESP8266, as bits returned by getEvents. 
+ */
+enum ESP8266Event {
+    ESP8266_EVENT_CONNECT           = 0x01, /* [<id>,]CONNECT */
+    ESP8266_EVENT_CLOSED            = 0x02, /* [<id>,]CLOSED or [<id>,]CONNECT FAIL */
+    ESP8266_EVENT_WIFI_CONNECTED    = 0x04,
+    ESP8266_EVENT_WIFI_GOT_IP       = 0x08,
+    ESP8266_EVENT_WIFI_DISCONNECT   = 0x10,
+    ESP8266_EVENT_READY             = 0x20, /* ESP8266 has started, all links are closed */
+};
+
+/**
+ * Called with data received from one of TCP or UDP(mux_id is 0 in single mode). 
+ */
+typedef void (*ESP8266DataCallback)(uint8_t mux_id, const uint8_t *data, uint32_t len, void *arg);
+
+/**
+ * Called when one of TCP or UDP is connected or closed(mux_id is 0 in single mode). 
+ */
+typedef void (*ESP8266LinkCallback)(uint8_t mux_id, bool connected, void *arg);
+
+/**
+ * Called when the state of station changes(state: ESP8266_WIFI_*). 
+ */
+typedef void (*ESP8266WiFiCallback)(uint8_t state, void *arg);
+
+/**
+ * Called when a command finishes(command: ESP8266_CMD_*). 
+ */
+typedef void (*ESP8266CommandCallback)(uint8_t command, bool success, void *arg);
+
+/**
+ * Called over and over while a blocking method waits. 
+ */
+typedef void (*ESP8266IdleCallback)(void *arg);
+
+/**
+ * Called to fill buffer with the next len bytes of data to send. 
+ * Return the length filled, which should be len. 
+ */
+typedef uint32_t (*ESP8266SourceCallback)(uint8_t *buffer, uint32_t len, void *arg);
+
+/**
+ * Where the data of an ESP8266Segment is. 
+ */
+enum ESP8266SegmentType {
+    ESP8266_SEGMENT_RAM = 0,
+    ESP8266_SEGMENT_FLASH,      /* PROGMEM */
+    ESP8266_SEGMENT_SOURCE,     /* Read from source, data passed as its arg */
+};
+
+/**
+ * One piece of the data sent by send(segs, count). 
+ */
+struct ESP8266Segment {
+    uint8_t type;               /* ESP8266_SEGMENT_* */
+    const void *data;
+    uint32_t len;
+    ESP8266SourceCallback source;
+};
+
+/**
+ * One AP found by scanAP. Fields left out by setAPListOption are 0. 
+ */
+struct ESP8266AP {
+    uint8_t ecn;                /* 0: OPEN, 1: WEP, 2: WPA_PSK, 3: WPA2_PSK, 4: WPA_WPA2_PSK */
+    char ssid[33];              /* Null-terminated */
+    int8_t rssi;                /* dBm */
+    uint8_t mac[6];
+    uint8_t channel;
+};
+
+/**
+ * What joinAPFast remembers of the last full join. Keep it where it survives 
+ * between joins(RTC memory or EEPROM across deep sleep for example) and zero 
+ * it before the first one. 
+ */
+struct ESP8266JoinCache {
+    uint8_t valid;              /* 0 until a full join filled the rest */
+    uint8_t bssid[6];           /* The MAC address of the AP */
+    uint8_t channel;
+    uint8_t ip[4];              /* The lease got by DHCP */
+    uint8_t gateway[4];
+    uint8_t netmask[4];
+};
+
+/**
+ * One AT command of a sequence, see runSequence. 
+ */
+struct ESP8266Step {
+    uint8_t command;            /* ESP8266_CMD_* */
+    const char *params;         /* Sent after the command, "_CUR=1" for example, or NULL */
+    String *response;           /* Set to the response of a query(AT+CIFSR for example) or NULL */
+    bool ok;                    /* Set by the run: the command succeeded */
+    uint32_t time;              /* Set by the run: ms from sending it to its result */
+};
+
+/*
+ * Returned by runSequence when a step can not be run. 
+ */
+#define ESP8266_SEQUENCE_REFUSED    (0xFF)
+
+/**
+ * Called for each AP found by scanAP. ap is only valid during the call. 
+ */
+typedef void (*ESP8266APCallback)(const ESP8266AP *ap, void *arg);
+
+/**
+ * Status of one link(mux_id 0-4) kept by the driver, see getLinkStatus. 
+ */
+struct ESP8266LinkStatus {
+    uint8_t id;
+    bool open;
+    bool known;                 /* false until the fields below are read by AT+CIPSTATUS */
+    bool server;                /* Accepted by the TCP server of ESP8266 */
+    char type[4];               /* "TCP", "UDP" or "SSL" */
+    uint8_t ip[4];              /* Remote IP */
+    uint16_t remote_port;
+    uint16_t local_port;
+};
+
+#ifdef ESP8266_USE_STATS
+/**
+ * Latency buckets of ESP8266CommandStats: bucket i counts commands which took 
+ * less than 2 * 4^i ms(2, 8, 32, 128, 512, 2048, 8192 ms), the last one the rest. 
+ */
+#define ESP8266_STATS_BUCKETS   (8)
+
+/**
+ * Statistics of one AT command. Counters stop at their maximum. 
+ */
+struct ESP8266CommandStats {
+    uint16_t count;             /* Finished, whatever the result */
+    uint16_t errors;            /* Ended by ERROR, FAIL or the like */
+    uint16_t timeouts;
+    uint16_t latency[ESP8266_STATS_BUCKETS];
+};
+
+/**
+ * Statistics collected when ESP8266_USE_STATS is defined, see getStats. 
+ */
+struct ESP8266Stats {
+    ESP8266CommandStats command[ESP8266_CMD_COUNT]; /* Indexed by ESP8266_CMD_* */
+    uint32_t sent[5];           /* Payload bytes sent by mux_id(0 in single mode) */
+    uint32_t received[5];       /* Payload bytes received by mux_id(0 in single mode) */
+    uint32_t dropped;           /* Payload bytes of +IPD abandoned */
+    uint16_t rx_full;           /* Times the UART receive buffer was found full */
+};
+#endif
+
+#if ESP8266_TRACE_LEVEL > 0
+/**
+ * What a trace entry records, with its arguments a and b. 
+ */
+enum ESP8266TraceCode {
+    ESP8266_TRACE_TX = 1,       /* A command sent: a = ESP8266_CMD_*. */
+    ESP8266_TRACE_RX,           /* Its result: a = ESP8266_CMD_*, b = 0/1 for OK, 2 for failure. */
+    ESP8266_TRACE_TIMEOUT,      /* No result: a = ESP8266_CMD_*, b = timeout in ms. */
+    ESP8266_TRACE_IPD,          /* +IPD header: a = mux_id(0xFF in single mode), b = length. */
+    ESP8266_TRACE_SEND,         /* AT+CIPSEND package: a = mux_id(0xFF in single mode), b = length. */
+    ESP8266_TRACE_DROP,         /* Payload abandoned: a = mux_id, b = bytes. */
+    ESP8266_TRACE_LINK,         /* CONNECT or CLOSED: a = mux_id, b = 1 when connected. */
+    ESP8266_TRACE_WIFI,         /* WIFI ...: a = ESP8266_WIFI_*. */
+};
+
+/**
+ * One entry of the trace ring. 
+ */
+struct ESP8266TraceEntry {
+    uint32_t time;              /* micros() */
+    uint8_t code;               /* ESP8266_TRACE_* */
+    uint8_t a;
+    uint16_t b;
+};
+#endif
+
+/*
+ * The operations of a UART of type Uart, bound by the constructor(used internally). 
+ *
+ * Calls are qualified with the type, so the byte loop of read calls available() 
+ * and read() of Uart directly instead of through the virtual table of Stream. 
+ */
+template <class Uart>
+struct ESP8266Transport {
+    static void begin(Stream *uart, uint32_t baud)
+    {
+        static_cast<Uart *>(uart)->begin(baud);
+    }
+    
+    /* Read up to len bytes which have come already. */
+    static uint16_t read(Stream *uart, uint8_t *buffer, uint16_t len)
+    {
+        Uart *u = static_cast<Uart *>(uart);
+        uint16_t n = 0;
+        while (n < len && u->Uart::available() > 0) {
+            buffer[n++] = u->Uart::read();
+        }
+        return n;
+    }
+};
+
+/*
+ * State of matching one target string incrementally(used internally). 
+ */
+struct ESP8266Matcher {
+    const char *target;         /* In flash */
+    uint8_t len;
+    uint8_t state;              /* Bytes of target matched so far */
+};
+
+
 /**
  * Provide an easy-to-use way to manipulate ESP8266. 
  */
 class ESP8266 {
  public:
 
-#ifdef ESP8266_USE_SOFTWARE_SERIAL
-    /*
-     * Constuctor. 
-     *
-     * @param uart - an reference of SoftwareSerial object. 
-     * @param baud - the buad rate to communicate with ESP8266(default:9600). 
-     *
-     * @warning parameter baud depends on the AT firmware. 9600 is an common value. 
-     */
-    ESP8266(SoftwareSerial &uart, uint32_t baud = 9600);
-#else /* HardwareSerial */
     /*
      * Constuctor. 
      *
-     * @param uart - an reference of HardwareSerial object. 
+     * @param uart - an reference of HardwareSerial, SoftwareSerial or any other 
+     *  Stream with begin(baud). Objects of different types can be used at once. 
      * @param baud - the buad rate to communicate with ESP8266(default:9600). 
      *
      * @warning parameter baud depends on the AT firmware. 9600 is an common value. 
      */
-    ESP8266(HardwareSerial &uart, uint32_t baud = 9600);
-#endif
+    template <class Uart>
+    ESP8266(Uart &uart, uint32_t baud = 9600): m_puart(&uart)
+    {
+        m_uart_begin = ESP8266Transport<Uart>::begin;
+        m_uart_read = ESP8266Transport<Uart>::read;
+        init(baud);
+    }
     
     
     /** 
@@ -74,13 +371,21 @@ class ESP8266 {
     /**
      * Restart ESP8266 by "AT+RST". 
      *
-     * This method will take 3 seconds or more. 
+     * This method returns when ESP8266 takes commands again: as soon as it prints 
+     * "ready", or after 5 seconds if it does not. 
      *
      * @retval true - success.
      * @retval false - failure.
      */
     bool restart(void);
     
+    /**
+     * Get the time the last restart took. 
+     *
+     * @return the milliseconds from AT+RST until ESP8266 took commands, 0 before any. 
+     */
+    uint32_t getBootTime(void);
+    
     /**
      * Get the version of AT Command Set. 
      * 
@@ -88,9 +393,33 @@ class ESP8266 {
      */
     String getVersion(void);
     
+    /**
+     * Change the baud rate of UART on both ESP8266 and this side by "AT+UART_CUR". 
+     *
+     * The new rate is checked with kick(). If ESP8266 does not answer at the new rate, 
+     * both sides are set back to the old one. 
+     *
+     * @param baud - the new baud rate(115200, 460800, 921600 for example). 
+     * @param persistent - true to save the rate in flash by "AT+UART_DEF", so that ESP8266 
+     *  starts with it next time. Otherwise restart goes back to the rate ESP8266 starts with. 
+     * @retval true - success, the new rate is in use.
+     * @retval false - failure, the old rate is in use.
+     */
+    bool setUARTBaud(uint32_t baud, bool persistent = false);
+    
+    /**
+     * Get the baud rate of UART in use. 
+     *
+     * @return the baud rate. 
+     */
+    uint32_t getUARTBaud(void);
+    
     /**
      * Set operation mode to staion. 
      * 
+     * Firmwares with AT+CWMODE_CUR change the mode at once without restarting, so 
+     * links stay open, and do not save it. Older ones save it and restart. 
+     * 
      * @retval true - success.
      * @retval false - failure.
      */
@@ -101,6 +430,7 @@ class ESP8266 {
      * 
      * @retval true - success.
      * @retval false - failure.
+     * @see bool setOprToStation(void);
      */
     bool setOprToSoftAP(void);
     
@@ -109,6 +439,7 @@ class ESP8266 {
      * 
      * @retval true - success.
      * @retval false - failure.
+     * @see bool setOprToStation(void);
      */
     bool setOprToStationSoftAP(void);
     
@@ -121,6 +452,31 @@ class ESP8266 {
      */
     String getAPList(void);
     
+    /**
+     * Search available APs and pass them to cb one by one as they come. 
+     *
+     * Unlike getAPList, memory used does not grow with the number of APs. 
+     *
+     * @param cb - called for each AP found. 
+     * @param arg - passed to cb. 
+     * @param ssid - only search the AP with this SSID, or NULL for all. 
+     * @retval true - success.
+     * @retval false - failure.
+     * @note This method will take a couple of seconds. 
+     */
+    bool scanAP(ESP8266APCallback cb, void *arg = NULL, const char *ssid = NULL);
+    
+    /**
+     * Set how ESP8266 lists APs by "AT+CWLAPOPT". 
+     *
+     * @param sort - true to list APs by RSSI, the strongest first. 
+     * @param mask - the fields to list: bit 0 ecn, bit 1 ssid, bit 2 rssi, bit 3 mac, 
+     *  bit 4 channel(default: 0x1F). Leaving fields out makes the list shorter. 
+     * @retval true - success.
+     * @retval false - failure.
+     */
+    bool setAPListOption(bool sort, uint16_t mask = 0x1F);
+    
     /**
      * Join in AP. 
      *
@@ -132,6 +488,31 @@ class ESP8266 {
      */
     bool joinAP(String ssid, String pwd);
     
+    /**
+     * Join in AP again, quickly. 
+     *
+     * With a valid cache this joins the AP of the cached BSSID without scanning 
+     * channels and, if static_ip, takes the cached lease as a static address 
+     * (AT+CIPSTA_CUR) instead of asking DHCP. Without, or if that fails, it joins 
+     * as joinAP does and fills the cache. Needs a firmware with the _CUR commands 
+     * for the quick way. 
+     *
+     * @param ssid - SSID of AP to join in. 
+     * @param pwd - Password of AP to join in. 
+     * @param cache - what the last full join found, updated by this. 
+     * @param static_ip - whether to skip DHCP. 
+     * @retval true - success.
+     * @retval false - failure.
+     */
+    bool joinAPFast(String ssid, String pwd, ESP8266JoinCache *cache, bool static_ip = true);
+    
+    /**
+     * Get the time the last joinAP or joinAPFast took. 
+     *
+     * @return the milliseconds from the request to the result. 
+     */
+    uint32_t getJoinTime(void);
+    
     /**
      * Leave AP joined before. 
      *
@@ -167,6 +548,38 @@ class ESP8266 {
      */
     String getIPStatus(void);
     
+    /**
+     * Read the status of all links by "AT+CIPSTATUS" into the table 
+     * returned by getLinkStatus. 
+     *
+     * @retval true - success.
+     * @retval false - failure.
+     */
+    bool updateLinkStatus(void);
+    
+    /**
+     * Get the status of a link. 
+     *
+     * The table is kept up to date by [<id>,]CONNECT and [<id>,]CLOSED 
+     * from ESP8266, so this only talks to ESP8266 when a link has opened 
+     * since the last updateLinkStatus. 
+     *
+     * @param mux_id - the identifier of this TCP/UDP(available value: 0 - 4). 
+     * @return the status or NULL if mux_id is out of range. 
+     */
+    const ESP8266LinkStatus *getLinkStatus(uint8_t mux_id);
+    
+    /**
+     * Whether a link is open, as told by [<id>,]CONNECT and [<id>,]CLOSED. 
+     *
+     * Unlike getLinkStatus, this never talks to ESP8266. 
+     *
+     * @param mux_id - the identifier of this TCP/UDP(available value: 0 - 4). 
+     * @retval true - open.
+     * @retval false - closed or mux_id out of range. 
+     */
+    bool isLinkOpen(uint8_t mux_id);
+    
     /**
      * Get the IP address of ESP8266. 
      *
@@ -199,7 +612,8 @@ class ESP8266 {
     /**
      * Create TCP connection in single mode. 
      * 
-     * @param addr - the IP or domain name of the target host. 
+     * @param addr - the IP or domain name of the target host(a name is looked 
+     *  up once and its address kept, see setDNSCacheTTL). 
      * @param port - the port number of the target host. 
      * @retval true - success.
      * @retval false - failure.
@@ -217,7 +631,8 @@ class ESP8266 {
     /**
      * Register UDP port number in single mode.
      * 
-     * @param addr - the IP or domain name of the target host. 
+     * @param addr - the IP or domain name of the target host(a name is looked 
+     *  up once and its address kept, see setDNSCacheTTL). 
      * @param port - the port number of the target host. 
      * @retval true - success.
      * @retval false - failure.
@@ -236,7 +651,8 @@ class ESP8266 {
      * Create TCP connection in multiple mode. 
      * 
      * @param mux_id - the identifier of this TCP(available value: 0 - 4). 
-     * @param addr - the IP or domain name of the target host. 
+     * @param addr - the IP or domain name of the target host(a name is looked 
+     *  up once and its address kept, see setDNSCacheTTL). 
      * @param port - the port number of the target host. 
      * @retval true - success.
      * @retval false - failure.
@@ -256,7 +672,8 @@ class ESP8266 {
      * Register UDP port number in multiple mode.
      * 
      * @param mux_id - the identifier of this TCP(available value: 0 - 4). 
-     * @param addr - the IP or domain name of the target host. 
+     * @param addr - the IP or domain name of the target host(a name is looked 
+     *  up once and its address kept, see setDNSCacheTTL). 
      * @param port - the port number of the target host. 
      * @retval true - success.
      * @retval false - failure.
@@ -271,6 +688,34 @@ class ESP8266 {
      * @retval false - failure.
      */
     bool unregisterUDP(uint8_t mux_id);
+    
+    /**
+     * Get the IP address of a host. 
+     *
+     * A domain name is looked up by AT+CIPDOMAIN the first time and its address 
+     * kept for the next calls and connections, until the time set by 
+     * setDNSCacheTTL has passed or a connection to it fails. 
+     *
+     * @param host - the IP or domain name of the host. 
+     * @param ip - set to the address. 
+     * @retval true - success.
+     * @retval false - failure.
+     */
+    bool resolveHost(String host, uint8_t *ip);
+    
+    /**
+     * Set how long the address of a host name is kept. 
+     *
+     * @param ttl - the duration in seconds(default: 300, at most 4294967 - 
+     *  about 49 days - longer ones are cut to that), 0 to not keep them: names 
+     *  then go to AT+CIPSTART as they are, to be looked up by ESP8266. 
+     */
+    void setDNSCacheTTL(uint32_t ttl);
+    
+    /**
+     * Forget the addresses of all host names. 
+     */
+    void flushDNSCache(void);
 
 
     /**
@@ -302,6 +747,8 @@ class ESP8266 {
     /**
      * Stop TCP Server(Only in multiple mode). 
      * 
+     * Older firmwares can only stop it by restarting, which closes all links. 
+     * 
      * @retval true - success.
      * @retval false - failure.
      */
@@ -330,6 +777,8 @@ class ESP8266 {
     /**
      * Send data based on TCP or UDP builded already in single mode. 
      * 
+     * Data longer than ESP8266 accepts at a time is sent in several packages. 
+     * 
      * @param buffer - the buffer of data to send. 
      * @param len - the length of data to send. 
      * @retval true - success.
@@ -340,6 +789,8 @@ class ESP8266 {
     /**
      * Send data based on one of TCP or UDP builded already in multiple mode. 
      * 
+     * Data longer than ESP8266 accepts at a time is sent in several packages. 
+     * 
      * @param mux_id - the identifier of this TCP(available value: 0 - 4). 
      * @param buffer - the buffer of data to send. 
      * @param len - the length of data to send. 
@@ -348,6 +799,97 @@ class ESP8266 {
      */
     bool send(uint8_t mux_id, const uint8_t *buffer, uint32_t len);
     
+    /**
+     * Send data read from source based on TCP or UDP builded already in single mode. 
+     * 
+     * Data longer than ESP8266 accepts at a time is sent in several packages. 
+     * 
+     * @param source - the function filling the data to send piece by piece. 
+     * @param arg - passed to source. 
+     * @param len - the length of data to send. 
+     * @retval true - success.
+     * @retval false - failure.
+     */
+    bool sendStream(ESP8266SourceCallback source, void *arg, uint32_t len);
+    
+    /**
+     * Send data read from source based on one of TCP or UDP builded already in multiple mode. 
+     * 
+     * Data longer than ESP8266 accepts at a time is sent in several packages. 
+     * 
+     * @param mux_id - the identifier of this TCP(available value: 0 - 4). 
+     * @param source - the function filling the data to send piece by piece. 
+     * @param arg - passed to source. 
+     * @param len - the length of data to send. 
+     * @retval true - success.
+     * @retval false - failure.
+     */
+    bool sendStream(uint8_t mux_id, ESP8266SourceCallback source, void *arg, uint32_t len);
+    
+    /**
+     * Send segments one after another as one piece of data based on TCP or UDP 
+     * builded already in single mode. 
+     * 
+     * Each segment is written from where it is, in RAM, in flash or by its source, 
+     * without being copied together: the total length is announced by one AT+CIPSEND 
+     * (several if longer than ESP8266 accepts at a time). 
+     * 
+     * @param segs - the segments. 
+     * @param count - the number of segments. 
+     * @retval true - success.
+     * @retval false - failure.
+     */
+    bool send(const ESP8266Segment *segs, uint8_t count);
+    
+    /**
+     * Send segments one after another as one piece of data based on one of TCP or 
+     * UDP builded already in multiple mode. 
+     * 
+     * @param mux_id - the identifier of this TCP(available value: 0 - 4). 
+     * @param segs - the segments. 
+     * @param count - the number of segments. 
+     * @retval true - success.
+     * @retval false - failure.
+     * @see bool send(const ESP8266Segment *segs, uint8_t count);
+     */
+    bool send(uint8_t mux_id, const ESP8266Segment *segs, uint8_t count);
+    
+    /**
+     * Put data in the send buffer of ESP8266 for one of TCP builded already in 
+     * multiple mode, without waiting for it to be sent(AT+CIPSENDBUF). 
+     * 
+     * Up to ESP8266_SEND_WINDOW packages(of at most 2048 bytes) are in flight per 
+     * link: when the window or the buffer of ESP8266 is full, this waits for the 
+     * oldest to be sent. Once a package failed, this fails until flushBuffered. 
+     * Do not mix with send on the same link before flushBuffered. 
+     * 
+     * @param mux_id - the identifier of this TCP(available value: 0 - 4). 
+     * @param buffer - the buffer of data to send. 
+     * @param len - the length of data to send. 
+     * @param timeout - the time waiting for room in the window. 
+     * @retval true - the data is in the buffer of ESP8266. 
+     * @retval false - failure. 
+     */
+    bool sendBuffered(uint8_t mux_id, const uint8_t *buffer, uint32_t len, uint32_t timeout = 10000);
+    
+    /**
+     * Wait until all packages of sendBuffered are sent. 
+     * 
+     * @param mux_id - the identifier of this TCP(available value: 0 - 4). 
+     * @param timeout - the time waiting. 
+     * @retval true - all were sent. 
+     * @retval false - one failed, the link closed or timeout. 
+     */
+    bool flushBuffered(uint8_t mux_id, uint32_t timeout = 10000);
+    
+    /**
+     * Get the number of packages of sendBuffered not sent yet. 
+     * 
+     * @param mux_id - the identifier of this TCP(available value: 0 - 4). 
+     * @return the number of packages in flight. 
+     */
+    uint8_t getBufferedCount(uint8_t mux_id);
+    
     /**
      * Receive data from TCP or UDP builded already in single mode. 
      *
@@ -382,50 +924,546 @@ class ESP8266 {
      * @return the length of data received actually. 
      */
     uint32_t recv(uint8_t *coming_mux_id, uint8_t *buffer, uint32_t buffer_size, uint32_t timeout = 1000);
-
- private:
-
-    /* 
-     * Empty the buffer or UART RX.
-     */
-    void rx_empty(void);
- 
-    /* 
-     * Recvive data from uart. Return all received data if target found or timeout. 
-     */
-    String recvString(String target, uint32_t timeout = 1000);
     
-    /* 
-     * Recvive data from uart. Return all received data if one of target1 and target2 found or timeout. 
+    /**
+     * Give one of TCP or UDP its own receive buffer. 
+     *
+     * Data coming from this TCP or UDP while it is not being received(during another recv, 
+     * a command or poll without data callback) is queued in the buffer instead of being 
+     * abandoned. The methods of receiving data read the queue first. 
+     *
+     * @param mux_id - the identifier of this TCP(available value: 0 - 4, 0 in single mode). 
+     * @param buffer - the buffer for queueing data, which must stay valid while in use(NULL to remove). 
+     * @param buffer_size - the length of the buffer(at most 65535). 
+     * @retval true - success.
+     * @retval false - failure.
      */
-    String recvString(String target1, String target2, uint32_t timeout = 1000);
+    bool setRecvBuffer(uint8_t mux_id, uint8_t *buffer, uint32_t buffer_size);
     
-    /* 
-     * Recvive data from uart. Return all received data if one of target1, target2 and target3 found or timeout. 
+    /**
+     * Get the length of data queued for one of TCP or UDP in multiple mode. 
+     *
+     * @param mux_id - the identifier of this TCP(available value: 0 - 4). 
+     * @return the length of data which can be received without waiting. 
      */
-    String recvString(String target1, String target2, String target3, uint32_t timeout = 1000);
+    uint32_t available(uint8_t mux_id);
     
-    /* 
-     * Recvive data from uart and search first target. Return true if target found, false for timeout.
+    /**
+     * Get the length of data abandoned for one of TCP or UDP in multiple mode. 
+     *
+     * Data is abandoned when it comes while another TCP or UDP is being received and 
+     * the receive buffer is full or not given. 
+     *
+     * @param mux_id - the identifier of this TCP(available value: 0 - 4). 
+     * @return the length of data abandoned since the object was created. 
+     */
+    uint32_t getOverflowCount(uint8_t mux_id);
+    
+    /**
+     * Give the driver a receive ring of its own, filled by pump. 
+     *
+     * The receive buffer of the UART(64 bytes on AVR) fills in 5 ms at 115200 baud, 
+     * so data is lost whenever the sketch does something else for longer. With a 
+     * ring every read of the driver takes from the ring, and while busy the sketch 
+     * only needs to call pump, which is cheap: from a timer interrupt or between 
+     * the pieces of long work. Bytes in the ring are abandoned when it is replaced 
+     * or removed. 
+     *
+     * @param buffer - the ring, 512 to 4096 bytes for example, which must stay valid 
+     *  while in use(NULL to read the UART directly). 
+     * @param size - the length of the ring(at least 2). One byte of it is kept unused. 
+     */
+    void setRxRing(uint8_t *buffer, uint16_t size);
+    
+    /**
+     * Move the bytes received by the UART into the receive ring. 
+     *
+     * It may be called from an interrupt on AVR and ARM: a call made while another 
+     * one is moving bytes returns at once. Nothing is moved without a ring or in 
+     * passthrough mode, which starts when its command is sent. 
+     *
+     * @return the number of bytes taken from the UART, those abandoned included. 
+     */
+    uint16_t pump(void);
+    
+    /**
+     * Get the length of data abandoned because the receive ring was full. 
+     *
+     * @return the length of data abandoned since the object was created. 
+     */
+    uint32_t getRxRingOverflow(void);
+    
+#ifdef ESP8266_USE_STATS
+    /**
+     * Get the statistics collected since the object was created or resetStats. 
+     *
+     * @param stats - where to copy them. 
+     */
+    void getStats(ESP8266Stats *stats);
+    
+    /**
+     * Clear the statistics. 
+     */
+    void resetStats(void);
+#endif
+
+#if ESP8266_TRACE_LEVEL > 0
+    /**
+     * Print the trace ring, oldest entry first, as hexadecimal lines between 
+     * "ESP8266 TRACE BEGIN" and "ESP8266 TRACE END" for extras/host/tracedecode. 
+     *
+     * Entries are recorded in RAM only, so tracing does not disturb the timing 
+     * it is looking at. Printing them does: call it when the problem is over. 
+     *
+     * @param out - where to print, Serial for example. 
+     */
+    void dumpTrace(Print &out);
+#endif
+    
+    /**
+     * Process data from ESP8266 without waiting. 
+     *
+     * Received data, connection and Wi-Fi events are delivered to the callbacks and 
+     * the command submitted by an asynchronous method is advanced. Call it as often 
+     * as possible, in loop() for example. 
+     *
+     * @note Callbacks are called from here and should not call blocking methods. 
+     */
+    void poll(void);
+    
+    /**
+     * Whether a command is in progress. 
+     *
+     * @retval true - busy, asynchronous methods will fail.
+     * @retval false - idle.
+     */
+    bool isBusy(void);
+    
+    /**
+     * Get the unsolicited results received since the last call. 
+     *
+     * They are picked out of any response, including while a command is in 
+     * progress, so none is lost between commands. 
+     *
+     * @return bits of ESP8266_EVENT_*, 0 if none. 
+     */
+    uint8_t getEvents(void);
+    
+    /**
+     * Set the function called with data received. 
+     *
+     * Data which is not being received by recv is passed to the callback instead of 
+     * being queued. 
+     *
+     * @param cb - the callback(NULL to remove). 
+     * @param arg - passed to the callback. 
+     */
+    void setDataCallback(ESP8266DataCallback cb, void *arg = NULL);
+    
+    /**
+     * Set the function called when one of TCP or UDP is connected or closed. 
+     *
+     * @param cb - the callback(NULL to remove). 
+     * @param arg - passed to the callback. 
      */
-    bool recvFind(String target, uint32_t timeout = 1000);
+    void setLinkCallback(ESP8266LinkCallback cb, void *arg = NULL);
+    
+    /**
+     * Set the function called when station connects, gets IP or disconnects. 
+     *
+     * @param cb - the callback(NULL to remove). 
+     * @param arg - passed to the callback. 
+     */
+    void setWiFiCallback(ESP8266WiFiCallback cb, void *arg = NULL);
+    
+    /**
+     * Set the function called when a command finishes. 
+     *
+     * @param cb - the callback(NULL to remove). 
+     * @param arg - passed to the callback. 
+     */
+    void setCommandCallback(ESP8266CommandCallback cb, void *arg = NULL);
+    
+    /**
+     * Set the function called while a blocking method waits. 
+     *
+     * It lets other work go on during long commands, such as reading the UART of 
+     * another ESP8266(see ESP8266Pool). Methods of this object, pump excepted, must 
+     * not be called from it. 
+     *
+     * @param cb - the callback(NULL to remove). 
+     * @param arg - passed to the callback. 
+     */
+    void setIdleCallback(ESP8266IdleCallback cb, void *arg = NULL);
+    
+    /**
+     * Join in AP without waiting. 
+     *
+     * The result is passed to the command callback with ESP8266_CMD_CWJAP. 
+     *
+     * @param ssid - SSID of AP to join in. 
+     * @param pwd - Password of AP to join in. 
+     * @retval true - submitted.
+     * @retval false - busy.
+     */
+    bool joinAPAsync(String ssid, String pwd);
+    
+    /**
+     * Create TCP connection in single mode without waiting. 
+     *
+     * The result is passed to the command callback with ESP8266_CMD_CIPSTART. 
+     *
+     * @param addr - the IP or domain name of the target host. 
+     * @param port - the port number of the target host. 
+     * @retval true - submitted.
+     * @retval false - busy.
+     */
+    bool createTCPAsync(String addr, uint32_t port);
+    
+    /**
+     * Create TCP connection in multiple mode without waiting. 
+     *
+     * The result is passed to the command callback with ESP8266_CMD_CIPSTART. 
+     *
+     * @param mux_id - the identifier of this TCP(available value: 0 - 4). 
+     * @param addr - the IP or domain name of the target host. 
+     * @param port - the port number of the target host. 
+     * @retval true - submitted.
+     * @retval false - busy.
+     */
+    bool createTCPAsync(uint8_t mux_id, String addr, uint32_t port);
+    
+    /**
+     * Register UDP port number in single mode without waiting. 
+     *
+     * The result is passed to the command callback with ESP8266_CMD_CIPSTART. 
+     *
+     * @param addr - the IP or domain name of the target host. 
+     * @param port - the port number of the target host. 
+     * @retval true - submitted.
+     * @retval false - busy.
+     */
+    bool registerUDPAsync(String addr, uint32_t port);
+    
+    /**
+     * Register UDP port number in multiple mode without waiting. 
+     *
+     * The result is passed to the command callback with ESP8266_CMD_CIPSTART. 
+     *
+     * @param mux_id - the identifier of this UDP(available value: 0 - 4). 
+     * @param addr - the IP or domain name of the target host. 
+     * @param port - the port number of the target host. 
+     * @retval true - submitted.
+     * @retval false - busy.
+     */
+    bool registerUDPAsync(uint8_t mux_id, String addr, uint32_t port);
+    
+    /**
+     * Release TCP connection or unregister UDP in single mode without waiting. 
+     *
+     * The result is passed to the command callback with ESP8266_CMD_CIPCLOSE. 
+     *
+     * @retval true - submitted.
+     * @retval false - busy.
+     */
+    bool releaseTCPAsync(void);
+    
+    /**
+     * Release TCP connection or unregister UDP in multiple mode without waiting. 
+     *
+     * The result is passed to the command callback with ESP8266_CMD_CIPCLOSE. 
+     *
+     * @param mux_id - the identifier of this TCP(available value: 0 - 4). 
+     * @retval true - submitted.
+     * @retval false - busy.
+     */
+    bool releaseTCPAsync(uint8_t mux_id);
+    
+    /**
+     * Send data in single mode without waiting. 
+     *
+     * The result is passed to the command callback with ESP8266_CMD_CIPSEND. 
+     *
+     * @param buffer - the buffer of data to send, which must stay valid until the callback. 
+     * @param len - the length of data to send. 
+     * @retval true - submitted.
+     * @retval false - busy.
+     */
+    bool sendAsync(const uint8_t *buffer, uint32_t len);
+    
+    /**
+     * Send data in multiple mode without waiting. 
+     *
+     * The result is passed to the command callback with ESP8266_CMD_CIPSEND. 
+     *
+     * @param mux_id - the identifier of this TCP(available value: 0 - 4). 
+     * @param buffer - the buffer of data to send, which must stay valid until the callback. 
+     * @param len - the length of data to send. 
+     * @retval true - submitted.
+     * @retval false - busy.
+     */
+    bool sendAsync(uint8_t mux_id, const uint8_t *buffer, uint32_t len);
+    
+    /**
+     * Run AT commands one after the other. 
+     *
+     * Each step is sent as soon as the result of the one before has come and the 
+     * run stops at the first failure. Commands go as given, without the queries 
+     * the methods doing the same make first(setOprToStation asks the mode before 
+     * setting it for example), so bringing ESP8266 up with one sequence takes 
+     * fewer round trips: 
+     *
+     *     ESP8266Step steps[] = {
+     *         { ESP8266_CMD_AT },
+     *         { ESP8266_CMD_CWMODE, "_CUR=1" },
+     *         { ESP8266_CMD_CWJAP, "_CUR=\"ITEAD\",\"12345678\"" },
+     *         { ESP8266_CMD_CIPMUX, "=1" },
+     *         { ESP8266_CMD_CIFSR, NULL, &ip },
+     *     };
+     *
+     * AT+RST, AT+UART_*, AT+CIPSEND and AT+CIPSENDBUF can not be steps: the 
+     * methods doing them keep the state of the driver in step with ESP8266. 
+     *
+     * @param steps - the commands, whose ok and time are set by the run. 
+     * @param count - the number of steps(at most 254). 
+     * @return the number of steps which succeeded(count if all did), or 
+     *  ESP8266_SEQUENCE_REFUSED if nothing was sent because a command can not be 
+     *  a step or count is too large. 
+     */
+    uint8_t runSequence(ESP8266Step *steps, uint8_t count);
+    
+    /**
+     * Start running AT commands one after the other without waiting. 
+     *
+     * poll sends each step when the one before has succeeded, and isBusy is 
+     * true until the run is over. The result of each step is passed to the 
+     * command callback too. 
+     *
+     * @param steps - the commands, which must stay valid until the run is over. 
+     * @param count - the number of steps. 
+     * @retval true - submitted.
+     * @retval false - busy, a command can not be a step or count is above 254. 
+     * @see uint8_t runSequence(ESP8266Step *steps, uint8_t count);
+     */
+    bool runSequenceAsync(ESP8266Step *steps, uint8_t count);
+    
+    /**
+     * Enter passthrough mode based on TCP or UDP builded already in single mode. 
+     *
+     * UART becomes a raw pipe to the connection: data written to the stream is sent 
+     * without AT+CIPSEND and data received is read from the stream without +IPD. 
+     * No other method should be called until exitPassthrough. 
+     *
+     * @retval true - success.
+     * @retval false - failure.
+     * @see getPassthroughStream
+     */
+    bool enterPassthrough(void);
+    
+    /**
+     * Leave passthrough mode. 
+     *
+     * "+++" is sent with one second of silence before and after it, then 
+     * data not read yet is abandoned. 
+     *
+     * @retval true - success.
+     * @retval false - failure.
+     */
+    bool exitPassthrough(void);
+    
+    /**
+     * Whether in passthrough mode. 
+     *
+     * @retval true - in passthrough mode.
+     * @retval false - in AT command mode.
+     */
+    bool isPassthrough(void);
+    
+    /**
+     * Get the stream of the connection in passthrough mode. 
+     *
+     * @return the stream to read and write data, or NULL if not in passthrough mode. 
+     */
+    Stream *getPassthroughStream(void);
+
+ private:
+
+    /*
+     * Set up the state shared by the constructors. 
+     */
+    void init(uint32_t baud);
     
     /* 
-     * Recvive data from uart and search first target and cut out the substring between begin and end(excluding begin and end self). 
-     * Return true if target found, false for timeout.
+     * Empty the buffer or UART RX. A +IPD frame being received is abandoned.
+     */
+    void rx_empty(void);
+    
+    /*
+     * One pass of a blocking wait: poll, then the idle callback. 
+     */
+    void waitStep(void);
+    
+    /*
+     * Read what has come from ESP8266, from the receive ring if there is one. 
+     *
+     * @return the number of bytes read, 0 if none has come. 
+     */
+    uint16_t rx_read(uint8_t *buffer, uint16_t len);
+    
+    /*
+     * Dispatch all data in UART RX: payload to recv, the data callback or the queues, 
+     * responses to the command in progress and events to their callbacks. 
+     * Stop early once the package wanted by recv is complete. 
+     */
+    void rx_dispatch(void);
+    
+    /*
+     * Dispatch one byte outside of payload. 
+     */
+    void rx_byte(char c);
+    
+    /*
+     * Dispatch payload of the package being received, as much as one read takes. 
+     *
+     * @retval false - no byte has come. 
+     */
+    bool rx_payload(void);
+    
+    /*
+     * Dispatch the line just ended if it is an unsolicited result. 
+     */
+    void rx_line(void);
+    
+    /*
+     * Parse records of the response in progress, each one prefix followed by 
+     * fields separated by ',' and ended by end. 
+     */
+    void fieldBegin(const char *prefix, char end);
+    void fieldStep(char c);
+    
+    /*
+     * Store one byte of the field being parsed, or the field when it ends: 
+     * "+CWLAP:(<ecn>,"<ssid>",<rssi>,"<mac>",<ch>)" for scanAP. 
+     */
+    void apChar(char c);
+    void apField(void);
+    
+    /*
+     * The same for "+CIPSTATUS:<id>,"<type>","<ip>",<port>,<local port>,<server>". 
+     */
+    void linkChar(char c);
+    void linkField(void);
+    void linkRecord(void);
+    
+    /*
+     * Forget what is known about a link. 
+     */
+    void linkReset(uint8_t id, bool open);
+    
+    /*
+     * Start a command: wait first if another command is in progress, then send the 
+     * command from the table and expect its responses. The caller sends the rest. 
+     *
+     * @param cmd - ESP8266_CMD_*. 
+     */
+    void cmdBegin(uint8_t cmd);
+    
+    /*
+     * Change the responses expected by the command in progress(all in flash). 
+     *
+     * @param ok - the response of success. 
+     * @param ok2 - another response of success or NULL. 
+     * @param fail - the response of failure or NULL. 
+     * @param timeout - the duration waitting response. 
+     */
+    void cmdExpect(const char *ok, const char *ok2, const char *fail, uint32_t timeout);
+    
+    /*
+     * Cut out the response between begin and end(in flash, excluding begin and end self) into data. 
+     * The command fails if it is not found. 
+     */
+    void cmdFilter(const char *begin, const char *end, String *data);
+    
+    /*
+     * Feed one byte of response to the command in progress. 
+     */
+    void cmdStep(char c);
+    
+    /*
+     * Finish the command in progress and call the command callback. 
+     */
+    void cmdEnd(bool success);
+    
+    /*
+     * Wait for the command in progress. Return true if it succeeded. 
+     */
+    bool cmdWait(void);
+    
+    /*
+     * Start sending count segments(mux_id is -1 in single mode) by AT+CIPSEND, 
+     * or by AT+CIPSENDBUF for one package. 
+     */
+    void sendBegin(int8_t mux_id, const ESP8266Segment *segs, uint8_t count, uint8_t cmd = ESP8266_CMD_CIPSEND);
+    
+    /*
+     * Start sending one segment, kept in m_send_one. 
+     */
+    void sendBegin(int8_t mux_id, uint8_t type, const void *data, uint32_t len, ESP8266SourceCallback source,
+        uint8_t cmd = ESP8266_CMD_CIPSEND);
+    
+    /*
+     * Set the operation mode, restarting only if the firmware needs it. 
+     */
+    bool setOprMode(uint8_t mode);
+    
+    /*
+     * Whether the firmware has the _CUR commands(AT 1.x), asked once. 
+     */
+    bool hasCurCommands(void);
+    
+    /*
+     * Wait until at most most packages of sendBuffered are in flight on mux_id. 
+     * Return false if one failed, the link closed or timeout. 
+     */
+    bool windowWait(uint8_t mux_id, uint8_t most, unsigned long start, uint32_t timeout);
+    
+    /*
+     * Forget the packages in flight on mux_id, failed if the link closed with some. 
      */
-    bool recvFindAndFilter(String target, String begin, String end, String &data, uint32_t timeout = 1000);
+    void windowReset(uint8_t id, bool closed);
+    
+    /*
+     * Send AT+CIPSEND for the next package and wait for the prompt. 
+     */
+    void sendHeader(void);
+    
+    /*
+     * Send the payload of the package after the prompt and wait for the result. 
+     */
+    void sendPayload(void);
     
     /*
      * Receive a package from uart. 
      *
      * @param buffer - the buffer storing data. 
      * @param buffer_size - guess what!
-     * @param data_len - the length of data actually received(maybe more than buffer_size, the remained data will be abandoned).
+     * @param data_len - the length of data left in the package when copying started(maybe more than buffer_size, 
+     *  the remained data will be returned by the next call).
      * @param timeout - the duration waitting data comming.
      * @param coming_mux_id - in single connection mode, should be NULL and not NULL in multiple. 
+     * @param mux_id - the identifier wanted, -1 for any. Packages of others are queued. 
      */
-    uint32_t recvPkg(uint8_t *buffer, uint32_t buffer_size, uint32_t *data_len, uint32_t timeout, uint8_t *coming_mux_id);
+    uint32_t recvPkg(uint8_t *buffer, uint32_t buffer_size, uint32_t *data_len, uint32_t timeout, uint8_t *coming_mux_id, int8_t mux_id = -1);
+    
+    /*
+     * Take data queued for mux_id. Return the length of data taken.
+     */
+    uint32_t dequeue(uint8_t mux_id, uint8_t *buffer, uint32_t buffer_size);
+    
+    /*
+     * Feed one byte to the +IPD header parser. Return true if a header with payload has just ended.
+     */
+    bool ipdStep(char c);
     
     
     bool eAT(void);
@@ -434,33 +1472,231 @@ class ESP8266 {
     
     bool qATCWMODE(uint8_t *mode);
     bool sATCWMODE(uint8_t mode);
-    bool sATCWJAP(String ssid, String pwd);
+    bool sATCWMODECUR(uint8_t mode);
+    bool qATCWMODECUR(void);
+    bool sATCWJAPCUR(const String &ssid, const String &pwd, const uint8_t *bssid);
+    bool qATCWJAP(ESP8266JoinCache *cache);
+    bool sATCIPSTACUR(const uint8_t *ip, const uint8_t *gateway, const uint8_t *netmask);
+    bool qATCIPSTA(ESP8266JoinCache *cache);
+    bool sATCWDHCPCUR(bool enable);
+    bool sATCIPDOMAIN(const String &host, uint8_t *ip);
     bool eATCWLAP(String &list);
+    bool sATCWLAP(ESP8266APCallback cb, void *arg, const char *ssid);
+    bool sATCWLAPOPT(bool sort, uint16_t mask);
     bool eATCWQAP(void);
-    bool sATCWSAP(String ssid, String pwd, uint8_t chl, uint8_t ecn);
+    bool sATCWSAP(const String &ssid, const String &pwd, uint8_t chl, uint8_t ecn);
     bool eATCWLIF(String &list);
     
+    bool eATCIPSTATUS(void);
     bool eATCIPSTATUS(String &list);
-    bool sATCIPSTARTSingle(String type, String addr, uint32_t port);
-    bool sATCIPSTARTMultiple(uint8_t mux_id, String type, String addr, uint32_t port);
+    
+#if ESP8266_DNS_CACHE > 0
+    /*
+     * Find the entry of the DNS cache for host, looking it up by AT+CIPDOMAIN 
+     * if lookup and it is not there. Return -1 when host is an IP, is not 
+     * kept or was not found. 
+     */
+    int8_t dnsFind(const String &host, bool lookup);
+#endif
+    
+    /*
+     * The helpers of commands which can be asynchronous only submit them, 
+     * cmdWait finishes them. AT+CIPSTART gets the address kept for addr, 
+     * looked up first if lookup. 
+     */
+    bool sATCWJAP(const String &ssid, const String &pwd);
+    bool sATCIPSTARTSingle(const __FlashStringHelper *type, const String &addr, uint32_t port, bool lookup);
+    bool sATCIPSTARTMultiple(uint8_t mux_id, const __FlashStringHelper *type, const String &addr, uint32_t port, bool lookup);
+    void printHost(const String &addr, int8_t entry);
     bool sATCIPSENDSingle(const uint8_t *buffer, uint32_t len);
     bool sATCIPSENDMultiple(uint8_t mux_id, const uint8_t *buffer, uint32_t len);
+    bool sATCIPSENDBUF(uint8_t mux_id, const uint8_t *buffer, uint32_t len);
     bool sATCIPCLOSEMulitple(uint8_t mux_id);
     bool eATCIPCLOSESingle(void);
+    
     bool eATCIFSR(String &list);
     bool sATCIPMUX(uint8_t mode);
     bool sATCIPSERVER(uint8_t mode, uint32_t port = 333);
     bool sATCIPSTO(uint32_t timeout);
+    bool sATCIPMODE(uint8_t mode);
+    bool sATUART(uint32_t baud, bool persistent);
+    
+    /*
+     * Send the next step of the sequence in progress. 
+     */
+    void seqNext(void);
+    bool eATCIPSENDPassthrough(void);
+    
+    Stream *m_puart; /* The UART to communicate with ESP8266 */
+    void (*m_uart_begin)(Stream *uart, uint32_t baud);
+    uint16_t (*m_uart_read)(Stream *uart, uint8_t *buffer, uint16_t len);
+    
+    /*
+     * The receive ring of setRxRing. pump, maybe in an interrupt, moves m_ring_head 
+     * and rx_read moves m_ring_tail, so each index has a single writer. The ring is 
+     * empty when they are equal. 
+     */
+    uint8_t *m_ring;            /* NULL when the UART is read directly */
+    uint16_t m_ring_size;
+    volatile uint16_t m_ring_head; /* Where pump writes next */
+    volatile uint16_t m_ring_tail; /* Where rx_read reads next */
+    volatile bool m_ring_pumping; /* pump is running, so another call returns at once */
+    volatile uint32_t m_ring_overflow;
     
     /*
      * +IPD,len:data
      * +IPD,id,len:data
+     *
+     * The parser state lives here so that a package can be split across calls. 
      */
+    uint8_t m_ipd_state;    /* Which part of the frame is expected next */
+    uint8_t m_ipd_pos;      /* Bytes of "+IPD," matched */
+    int8_t m_ipd_id;        /* The mux_id of the frame or -1 in single mode */
+    uint32_t m_ipd_len;     /* The length being parsed, then the payload bytes left */
     
-#ifdef ESP8266_USE_SOFTWARE_SERIAL
-    SoftwareSerial *m_puart; /* The UART to communicate with ESP8266 */
-#else
-    HardwareSerial *m_puart; /* The UART to communicate with ESP8266 */
+    /*
+     * Receive queue of each mux_id in multiple mode. 
+     */
+    struct LinkBuffer {
+        uint8_t *buffer;
+        uint16_t size;
+        uint16_t head;          /* Index of the oldest byte */
+        uint16_t count;         /* Bytes queued */
+        uint32_t overflow;      /* Bytes abandoned */
+    } m_link[5];
+    uint8_t m_link_next;        /* Where the next search of queued data starts */
+    
+    /*
+     * The package wanted by recv in progress. 
+     */
+    uint8_t *m_sink;            /* NULL when recv is not in progress */
+    uint32_t m_sink_size;
+    uint32_t m_sink_len;
+    int8_t m_sink_id;           /* The mux_id wanted or -1 for any */
+    int8_t m_sink_from;         /* The mux_id of the package received */
+    bool m_sink_done;
+    
+    /*
+     * The command in progress. 
+     */
+    uint8_t m_cmd;              /* ESP8266_CMD_NONE when idle */
+    bool m_cmd_ok;              /* The result of the last command */
+    uint8_t m_cmd_filter;       /* Where the filter is in the response */
+    ESP8266Matcher m_cmd_target[3]; /* ok, ok2 and fail */
+    ESP8266Matcher m_cmd_begin;
+    ESP8266Matcher m_cmd_end;
+    String *m_cmd_data;
+    unsigned long m_cmd_start;
+    uint32_t m_cmd_timeout;
+    
+    /*
+     * The data being sent by AT+CIPSEND. 
+     */
+    uint8_t m_send_state;       /* Which response is expected next */
+    int8_t m_send_mux;          /* -1 in single mode */
+    ESP8266Segment m_send_one;  /* The segment of send and sendStream */
+    const ESP8266Segment *m_send_seg; /* The segment being sent */
+    uint8_t m_send_segs;        /* Segments left, m_send_seg included */
+    uint32_t m_send_pos;        /* Bytes of m_send_seg sent */
+    uint32_t m_send_len;        /* Bytes not sent yet */
+    uint16_t m_send_pkg;        /* Bytes of the package in progress */
+    bool m_send_short;          /* Source gave less than asked */
+    uint16_t m_send_seg_id;     /* Segment id given by AT+CIPSENDBUF, 0 until known */
+    
+    /*
+     * Packages of sendBuffered of each link, by segment id. 
+     */
+    struct SendWindow {
+        uint16_t queued;        /* The last put in the buffer of ESP8266 */
+        uint16_t acked;         /* The last sent from it */
+        bool failed;            /* SEND FAIL, or closed before all were sent */
+    } m_window[5];
+    
+    /*
+     * The sequence being run by runSequenceAsync. 
+     */
+    ESP8266Step *m_seq;         /* The next step, NULL when not running */
+    uint8_t m_seq_left;         /* Steps left, m_seq included */
+    bool m_seq_sent;            /* m_seq is in progress */
+    unsigned long m_seq_start;  /* When m_seq was sent */
+    
+    bool m_passthrough;         /* UART is a raw pipe once the prompt has come */
+    uint32_t m_boot_time;       /* The duration of the last restart in ms */
+    int8_t m_cur_commands;      /* The firmware has the _CUR commands: 1, has not: 0, not asked: -1 */
+    uint32_t m_join_time;       /* The duration of the last join in ms */
+    
+#if ESP8266_DNS_CACHE > 0
+    /*
+     * Addresses of host names, see resolveHost. 
+     */
+    struct DNSEntry {
+        char name[ESP8266_DNS_NAME_MAX + 1]; /* Empty when unused */
+        uint8_t ip[4];
+        unsigned long time;     /* millis() of the lookup */
+    } m_dns[ESP8266_DNS_CACHE];
+    uint32_t m_dns_ttl;         /* In ms, 0 when not keeping them */
+    int8_t m_dns_used;          /* The entry given to the AT+CIPSTART in progress or -1 */
+#endif
+    
+    uint32_t m_baud;            /* The rate of UART in use */
+    uint32_t m_boot_baud;       /* The rate ESP8266 starts with */
+    
+    /*
+     * The beginning of the line being received, for events. Holds the longest 
+     * one parsed, "4,65535,SEND FAIL". 
+     */
+    char m_line[24];
+    uint8_t m_line_len;
+    uint8_t m_events;           /* ESP8266_EVENT_* not taken by getEvents yet */
+    bool m_ready;               /* "ready" came since restart sent AT+RST */
+    bool m_must_restart;        /* AT+CIPSERVER=0 answered "we must restart" */
+    
+    /*
+     * The record being parsed from the response in progress. 
+     */
+    union {
+        ESP8266AP ap;           /* AT+CWLAP */
+        ESP8266LinkStatus link; /* AT+CIPSTATUS */
+    } m_fld;
+    ESP8266Matcher m_fld_prefix;
+    char m_fld_end;             /* Ends a record, '\0' when not parsing */
+    int8_t m_fld_index;         /* The field in progress, -1 outside of a record */
+    uint8_t m_fld_pos;          /* Characters of the field so far */
+    int32_t m_fld_num;
+    bool m_fld_neg;
+    bool m_fld_quoted;
+    
+    ESP8266APCallback m_ap_cb;  /* NULL when not scanning */
+    void *m_ap_arg;
+    uint16_t m_ap_mask;         /* The fields listed, set by AT+CWLAPOPT */
+    
+    ESP8266LinkStatus m_link_status[5];
+    
+    ESP8266DataCallback m_data_cb;
+    void *m_data_arg;
+    ESP8266LinkCallback m_link_cb;
+    void *m_link_arg;
+    ESP8266WiFiCallback m_wifi_cb;
+    void *m_wifi_arg;
+    ESP8266CommandCallback m_cmd_cb;
+    void *m_cmd_arg;
+    ESP8266IdleCallback m_idle_cb;
+    void *m_idle_arg;
+    
+#ifdef ESP8266_USE_STATS
+    ESP8266Stats m_stats;
+    unsigned long m_stats_start; /* When the command in progress was sent */
+#endif
+
+#if ESP8266_TRACE_LEVEL > 0
+    /*
+     * Add an entry to the trace ring, overwriting the oldest when full. 
+     */
+    void trace(uint8_t code, uint8_t a, uint16_t b);
+    
+    ESP8266TraceEntry m_trace[ESP8266_TRACE_SIZE];
+    uint16_t m_trace_next;      /* Where the next entry goes */
+    uint16_t m_trace_count;
 #endif
 };
 
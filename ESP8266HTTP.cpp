@@ -0,0 +1,422 @@
+/**
+ * @file ESP8266HTTP.cpp
+ * @brief The implementation of class ESP8266HTTP.
+ * @author WeeESP8266 contributors<https://github.com/igorzel/ITEADLIB_Arduino_WeeESP8266>
+ * @date 2026.10
+ *
+ * @par Copyright:
+ * Copyright (c) 2026 WeeESP8266 contributors. \n\n
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version. \n\n
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "ESP8266HTTP.h"
+
+#define HTTP_STATUS         (0) /* HTTP/1.x <code> <reason> */
+#define HTTP_HEADER         (1)
+#define HTTP_BODY           (2) /* Sized by Content-Length */
+#define HTTP_CHUNK_SIZE     (3)
+#define HTTP_CHUNK_DATA     (4)
+#define HTTP_CHUNK_END      (5) /* The empty line after the data of a chunk */
+#define HTTP_TRAILER        (6)
+#define HTTP_UNTIL_CLOSE    (7) /* Neither sized nor chunked: ended by the server closing */
+#define HTTP_DONE           (8)
+
+#define RECV_SLICE          (50)    /* ms waited at a time, to see the server closing */
+#define REQUEST_PIECES      (16)
+
+ESP8266HTTP::ESP8266HTTP(ESP8266 &wifi, uint8_t mux_first)
+{
+    m_wifi = &wifi;
+    m_mux_first = mux_first;
+    memset(m_link, 0, sizeof(m_link));
+    m_connects = 0;
+    m_state = HTTP_DONE;
+    m_status = 0;
+    m_head = false;
+    m_chunked = false;
+    m_close = false;
+    m_has_length = false;
+    m_length = 0;
+    m_body_len = 0;
+    m_line_len = 0;
+    m_sink = NULL;
+    m_sink_arg = NULL;
+}
+
+int ESP8266HTTP::get(const char *host, uint32_t port, const char *path,
+    ESP8266HTTPSink sink, void *arg, uint32_t timeout)
+{
+    return exchange(PSTR("GET"), true, host, port, path, NULL, NULL, 0, sink, arg, timeout);
+}
+
+int ESP8266HTTP::post(const char *host, uint32_t port, const char *path, const char *type,
+    const uint8_t *body, uint32_t len, ESP8266HTTPSink sink, void *arg, uint32_t timeout)
+{
+    char headers[64];
+
+    if (strlen(type) > sizeof(headers) - 17) {
+        return ESP8266HTTP_ERROR_SEND;
+    }
+    strcpy_P(headers, PSTR("Content-Type: "));
+    strcat(headers, type);
+    strcat_P(headers, PSTR("\r\n"));
+    return exchange(PSTR("POST"), true, host, port, path, headers, body, len, sink, arg, timeout);
+}
+
+int ESP8266HTTP::request(const char *method, const char *host, uint32_t port, const char *path,
+    const char *headers, const uint8_t *body, uint32_t len,
+    ESP8266HTTPSink sink, void *arg, uint32_t timeout)
+{
+    return exchange(method, false, host, port, path, headers, body, len, sink, arg, timeout);
+}
+
+int ESP8266HTTP::exchange(const char *method, bool method_flash, const char *host, uint32_t port,
+    const char *path, const char *headers, const uint8_t *body, uint32_t len,
+    ESP8266HTTPSink sink, void *arg, uint32_t timeout)
+{
+    unsigned long start = millis();
+    unsigned long spent;
+    bool head = !method_flash && strcmp_P(method, PSTR("HEAD")) == 0;
+    bool reused;
+    int8_t i;
+    int status;
+    uint8_t attempt;
+
+    m_body_len = 0;
+    for (attempt = 0; attempt < 2; attempt++) {
+        i = connect(host, port, &reused);
+        if (i < 0) {
+            return ESP8266HTTP_ERROR_CONNECT;
+        }
+        if (!sendRequest(i, method, method_flash, host, port, path, headers, body, len)) {
+            close(i);
+            if (reused) {
+                /* The server had dropped it, try a new connection. */
+                continue;
+            }
+            return ESP8266HTTP_ERROR_SEND;
+        }
+        spent = millis() - start;
+        status = readResponse(i, head, sink, arg, spent < timeout ? timeout - spent : 0);
+        if (status == ESP8266HTTP_ERROR_CONNECT && reused) {
+            /* Closed before answering: nothing was given to sink yet. */
+            close(i);
+            continue;
+        }
+        if (status < 0 || m_close || m_link[i].host[0] == '\0') {
+            close(i);
+        } else {
+            m_link[i].used = millis();
+        }
+        return status;
+    }
+    return ESP8266HTTP_ERROR_CONNECT;
+}
+
+uint32_t ESP8266HTTP::getBodyLength(void)
+{
+    return m_body_len;
+}
+
+uint32_t ESP8266HTTP::getConnectCount(void)
+{
+    return m_connects;
+}
+
+void ESP8266HTTP::closeAll(void)
+{
+    for (uint8_t i = 0; i < ESP8266HTTP_LINKS; i++) {
+        close(i);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+/* Connections */
+
+int8_t ESP8266HTTP::connect(const char *host, uint32_t port, bool *reused)
+{
+    int8_t found = -1;
+    uint8_t i;
+    uint8_t mux;
+
+    *reused = false;
+    for (i = 0; i < ESP8266HTTP_LINKS; i++) {
+        if (m_link[i].host[0] == '\0' || m_link[i].port != port || strcmp(m_link[i].host, host) != 0) {
+            continue;
+        }
+        if (m_wifi->isLinkOpen(m_mux_first + i)) {
+            *reused = true;
+            return i;
+        }
+        m_link[i].host[0] = '\0';
+    }
+
+    /* A free link, or the one unused for the longest time. */
+    for (i = 0; i < ESP8266HTTP_LINKS; i++) {
+        if (m_link[i].host[0] == '\0') {
+            found = i;
+            break;
+        }
+        if (found < 0 || (long)(m_link[i].used - m_link[found].used) < 0) {
+            found = i;
+        }
+    }
+    close(found);
+
+    mux = m_mux_first + found;
+    if (!m_wifi->createTCP(mux, host, port)) {
+        return -1;
+    }
+    m_connects++;
+    if (strlen(host) <= ESP8266HTTP_HOST_MAX) {
+        strcpy(m_link[found].host, host);
+        m_link[found].port = port;
+    }
+    return found;
+}
+
+void ESP8266HTTP::close(uint8_t i)
+{
+    uint8_t mux = m_mux_first + i;
+    if (m_wifi->isLinkOpen(mux)) {
+        m_wifi->releaseTCP(mux);
+    }
+    m_link[i].host[0] = '\0';
+}
+
+/*----------------------------------------------------------------------------*/
+/* Request */
+
+/*
+ * The request as segments in RAM or flash, sent without being copied together.
+ */
+struct Request {
+    ESP8266Segment seg[REQUEST_PIECES];
+    uint8_t count;
+};
+
+static void requestAdd(Request *req, const void *data, uint32_t len, uint8_t type)
+{
+    if (len > 0 && req->count < REQUEST_PIECES) {
+        req->seg[req->count].type = type;
+        req->seg[req->count].data = data;
+        req->seg[req->count].len = len;
+        req->seg[req->count].source = NULL;
+        req->count++;
+    }
+}
+
+#define requestText(req, text)  requestAdd((req), (text), strlen(text), ESP8266_SEGMENT_RAM)
+#define requestFlash(req, text) requestAdd((req), PSTR(text), sizeof(text) - 1, ESP8266_SEGMENT_FLASH)
+
+/* Decimal text of value, in buffer of 11 bytes at least. */
+static char *decimal(char *buffer, uint32_t value)
+{
+    char *p = buffer + 10;
+    *p = '\0';
+    do {
+        *--p = '0' + value % 10;
+        value /= 10;
+    } while (value > 0);
+    return p;
+}
+
+bool ESP8266HTTP::sendRequest(uint8_t i, const char *method, bool method_flash, const char *host,
+    uint32_t port, const char *path, const char *headers, const uint8_t *body, uint32_t len)
+{
+    Request req;
+    char number[11];
+    char length[11];
+
+    req.count = 0;
+    if (method_flash) {
+        requestAdd(&req, method, strlen_P(method), ESP8266_SEGMENT_FLASH);
+    } else {
+        requestText(&req, method);
+    }
+    requestFlash(&req, " ");
+    requestText(&req, path);
+    requestFlash(&req, " HTTP/1.1\r\nHost: ");
+    requestText(&req, host);
+    if (port != 80) {
+        requestFlash(&req, ":");
+        requestText(&req, decimal(number, port));
+    }
+    requestFlash(&req, "\r\n");
+    if (m_link[i].host[0] == '\0') {
+        /* Not kept open, see ESP8266HTTP_HOST_MAX. */
+        requestFlash(&req, "Connection: close\r\n");
+    }
+    if (headers) {
+        requestText(&req, headers);
+    }
+    if (body) {
+        requestFlash(&req, "Content-Length: ");
+        requestText(&req, decimal(length, len));
+        requestFlash(&req, "\r\n");
+    }
+    requestFlash(&req, "\r\n");
+    if (body) {
+        requestAdd(&req, body, len, ESP8266_SEGMENT_RAM);
+    }
+    return m_wifi->send(m_mux_first + i, req.seg, req.count);
+}
+
+/*----------------------------------------------------------------------------*/
+/* Response */
+
+int ESP8266HTTP::readResponse(uint8_t i, bool head, ESP8266HTTPSink sink, void *arg, uint32_t timeout)
+{
+    uint8_t buffer[64];
+    uint8_t mux = m_mux_first + i;
+    unsigned long start = millis();
+    uint32_t got = 0;
+    uint32_t n;
+
+    m_state = HTTP_STATUS;
+    m_status = 0;
+    m_head = head;
+    m_chunked = false;
+    m_close = false;
+    m_has_length = false;
+    m_length = 0;
+    m_body_len = 0;
+    m_line_len = 0;
+    m_sink = sink;
+    m_sink_arg = arg;
+
+    while (m_state != HTTP_DONE) {
+        if (millis() - start >= timeout) {
+            return ESP8266HTTP_ERROR_TIMEOUT;
+        }
+        n = m_wifi->recv(mux, buffer, sizeof(buffer), RECV_SLICE);
+        if (n > 0) {
+            got += n;
+            parse(buffer, n);
+            continue;
+        }
+        if (m_wifi->isLinkOpen(mux)) {
+            continue;
+        }
+        if (m_state == HTTP_UNTIL_CLOSE) {
+            break;
+        }
+        return got == 0 ? ESP8266HTTP_ERROR_CONNECT : ESP8266HTTP_ERROR_RESPONSE;
+    }
+    return m_status;
+}
+
+void ESP8266HTTP::parse(const uint8_t *data, uint32_t len)
+{
+    uint32_t n;
+    char c;
+
+    while (len > 0 && m_state != HTTP_DONE) {
+        if (m_state == HTTP_BODY || m_state == HTTP_CHUNK_DATA || m_state == HTTP_UNTIL_CLOSE) {
+            n = len;
+            if (m_state != HTTP_UNTIL_CLOSE && n > m_length) {
+                n = m_length;
+            }
+            if (m_sink) {
+                m_sink(data, n, m_sink_arg);
+            }
+            m_body_len += n;
+            data += n;
+            len -= n;
+            if (m_state != HTTP_UNTIL_CLOSE) {
+                m_length -= n;
+                if (m_length == 0) {
+                    m_state = m_state == HTTP_BODY ? HTTP_DONE : HTTP_CHUNK_END;
+                }
+            }
+            continue;
+        }
+        c = *data++;
+        len--;
+        if (c == '\n') {
+            m_line[m_line_len] = '\0';
+            parseLine();
+            m_line_len = 0;
+        } else if (c != '\r' && m_line_len < sizeof(m_line) - 1) {
+            m_line[m_line_len++] = c;
+        }
+    }
+}
+
+void ESP8266HTTP::parseLine(void)
+{
+    const char *value;
+
+    switch (m_state) {
+    case HTTP_STATUS:
+        if (m_line_len < 12 || strncmp_P(m_line, PSTR("HTTP/1."), 7) != 0) {
+            m_status = ESP8266HTTP_ERROR_RESPONSE;
+            m_close = true;
+            m_state = HTTP_DONE;
+            return;
+        }
+        m_close = m_line[7] == '0';
+        m_status = atoi(m_line + 9);
+        m_state = HTTP_HEADER;
+        break;
+    case HTTP_HEADER:
+        if (m_line_len > 0) {
+            value = strchr(m_line, ':');
+            if (value == NULL) {
+                break;
+            }
+            for (value++; *value == ' '; value++) {
+            }
+            if (strncasecmp_P(m_line, PSTR("Content-Length:"), 15) == 0) {
+                m_has_length = true;
+                m_length = strtoul(value, NULL, 10);
+            } else if (strncasecmp_P(m_line, PSTR("Transfer-Encoding:"), 18) == 0) {
+                m_chunked = strstr_P(value, PSTR("chunked")) != NULL;
+            } else if (strncasecmp_P(m_line, PSTR("Connection:"), 11) == 0) {
+                if (strncasecmp_P(value, PSTR("close"), 5) == 0) {
+                    m_close = true;
+                } else if (strncasecmp_P(value, PSTR("keep-alive"), 10) == 0) {
+                    m_close = false;
+                }
+            }
+            break;
+        }
+        /* End of headers */
+        if (m_status >= 100 && m_status < 200) {
+            /* Interim, the real response follows. */
+            m_state = HTTP_STATUS;
+        } else if (m_head || m_status == 204 || m_status == 304) {
+            m_state = HTTP_DONE;
+        } else if (m_chunked) {
+            m_state = HTTP_CHUNK_SIZE;
+        } else if (m_has_length) {
+            m_state = m_length > 0 ? HTTP_BODY : HTTP_DONE;
+        } else {
+            m_close = true;
+            m_state = HTTP_UNTIL_CLOSE;
+        }
+        break;
+    case HTTP_CHUNK_SIZE:
+        /* Extensions after ';' are ignored by strtoul. */
+        m_length = strtoul(m_line, NULL, 16);
+        m_state = m_length > 0 ? HTTP_CHUNK_DATA : HTTP_TRAILER;
+        break;
+    case HTTP_CHUNK_END:
+        m_state = HTTP_CHUNK_SIZE;
+        break;
+    case HTTP_TRAILER:
+        if (m_line_len == 0) {
+            m_state = HTTP_DONE;
+        }
+        break;
+    }
+}
@@ -0,0 +1,201 @@
+/**
+ * @file ESP8266HTTP.h
+ * @brief The definition of class ESP8266HTTP.
+ * @author WeeESP8266 contributors<https://github.com/igorzel/ITEADLIB_Arduino_WeeESP8266>
+ * @date 2026.10
+ *
+ * @par Copyright:
+ * Copyright (c) 2026 WeeESP8266 contributors. \n\n
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version. \n\n
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef __ESP8266HTTP_H__
+#define __ESP8266HTTP_H__
+
+#include "ESP8266.h"
+
+/*
+ * Connections kept open, on mux_id first to first + ESP8266HTTP_LINKS - 1.
+ */
+#ifndef ESP8266HTTP_LINKS
+#define ESP8266HTTP_LINKS       (2)
+#endif
+
+/*
+ * Longest host name whose connection is kept open(longer ones are closed
+ * after each request).
+ */
+#ifndef ESP8266HTTP_HOST_MAX
+#define ESP8266HTTP_HOST_MAX    (31)
+#endif
+
+/**
+ * Errors returned instead of a status code.
+ */
+enum ESP8266HTTPError {
+    ESP8266HTTP_ERROR_CONNECT   = -1,   /* No connection to the server */
+    ESP8266HTTP_ERROR_SEND      = -2,   /* The request was not sent */
+    ESP8266HTTP_ERROR_TIMEOUT   = -3,   /* The response did not come in time */
+    ESP8266HTTP_ERROR_RESPONSE  = -4,   /* The response is not HTTP/1.x */
+};
+
+/**
+ * Called with each part of a response body as it comes.
+ */
+typedef void (*ESP8266HTTPSink)(const uint8_t *data, uint32_t len, void *arg);
+
+/**
+ * HTTP/1.1 client on top of ESP8266 in multiple mode.
+ *
+ * Connections are kept alive and reused for the next request to the same
+ * host and port. Responses are parsed as they come: the body, sized by
+ * Content-Length, chunked or ended by the server closing, goes to a sink
+ * piece by piece, so bodies of any size fit in a small buffer.
+ */
+class ESP8266HTTP {
+ public:
+    /**
+     * Constructor.
+     *
+     * @param wifi - the ESP8266 to use, in multiple mode(see enableMUX).
+     * @param mux_first - the first of ESP8266HTTP_LINKS mux_id used.
+     */
+    ESP8266HTTP(ESP8266 &wifi, uint8_t mux_first = 0);
+
+    /**
+     * Send a GET request and read the response.
+     *
+     * @param host - the host name or IP address of the server.
+     * @param port - the port of the server.
+     * @param path - the path requested, "/" for example.
+     * @param sink - called with the body(NULL to throw it away).
+     * @param arg - passed to sink.
+     * @param timeout - the time allowed for the whole request, in milliseconds.
+     * @return the status code of the response or ESP8266HTTP_ERROR_*.
+     */
+    int get(const char *host, uint32_t port, const char *path,
+        ESP8266HTTPSink sink = NULL, void *arg = NULL, uint32_t timeout = 10000);
+
+    /**
+     * Send a POST request and read the response.
+     *
+     * @param type - the Content-Type of body.
+     * @param body - the body to send.
+     * @param len - the length of body.
+     * @return the status code of the response or ESP8266HTTP_ERROR_*.
+     * @see int get(const char *host, uint32_t port, const char *path, ...);
+     */
+    int post(const char *host, uint32_t port, const char *path, const char *type,
+        const uint8_t *body, uint32_t len,
+        ESP8266HTTPSink sink = NULL, void *arg = NULL, uint32_t timeout = 10000);
+
+    /**
+     * Send a request and read the response.
+     *
+     * @param method - "GET", "POST", "PUT", "DELETE", "HEAD" and so on.
+     * @param headers - more header lines, each ended by "\r\n", or NULL.
+     * @param body - the body to send or NULL.
+     * @param len - the length of body.
+     * @return the status code of the response or ESP8266HTTP_ERROR_*.
+     * @see int get(const char *host, uint32_t port, const char *path, ...);
+     */
+    int request(const char *method, const char *host, uint32_t port, const char *path,
+        const char *headers, const uint8_t *body, uint32_t len,
+        ESP8266HTTPSink sink = NULL, void *arg = NULL, uint32_t timeout = 10000);
+
+    /**
+     * Get the length of the body of the last response.
+     *
+     * @return the bytes passed to the sink.
+     */
+    uint32_t getBodyLength(void);
+
+    /**
+     * Get the number of connections opened since the object was created.
+     *
+     * @return the number of AT+CIPSTART done.
+     */
+    uint32_t getConnectCount(void);
+
+    /**
+     * Close all connections kept open.
+     */
+    void closeAll(void);
+
+ private:
+    /*
+     * One connection kept open.
+     */
+    struct Link {
+        char host[ESP8266HTTP_HOST_MAX + 1]; /* Empty when closed */
+        uint32_t port;
+        unsigned long used;     /* millis() of the last request */
+    };
+
+    /*
+     * Find the link open to host:port or open one.
+     *
+     * @param reused - set when the link was open already.
+     * @return the index of the link or -1.
+     */
+    int8_t connect(const char *host, uint32_t port, bool *reused);
+    void close(uint8_t i);
+
+    /*
+     * request, with method in flash when method_flash is set(get and post).
+     */
+    int exchange(const char *method, bool method_flash, const char *host, uint32_t port,
+        const char *path, const char *headers, const uint8_t *body, uint32_t len,
+        ESP8266HTTPSink sink, void *arg, uint32_t timeout);
+
+    /*
+     * Send the request on link i.
+     */
+    bool sendRequest(uint8_t i, const char *method, bool method_flash, const char *host,
+        uint32_t port, const char *path, const char *headers, const uint8_t *body, uint32_t len);
+
+    /*
+     * Read the response from link i.
+     *
+     * @return the status code, ESP8266HTTP_ERROR_TIMEOUT or ESP8266HTTP_ERROR_RESPONSE.
+     */
+    int readResponse(uint8_t i, bool head, ESP8266HTTPSink sink, void *arg, uint32_t timeout);
+
+    /*
+     * Parse bytes of the response, the body going to m_sink.
+     */
+    void parse(const uint8_t *data, uint32_t len);
+    void parseLine(void);
+
+    ESP8266 *m_wifi;
+    uint8_t m_mux_first;
+    Link m_link[ESP8266HTTP_LINKS];
+    uint32_t m_connects;
+
+    /*
+     * The response being parsed.
+     */
+    uint8_t m_state;            /* Which part of the response is expected next */
+    int m_status;
+    bool m_head;                /* The request was HEAD: no body whatever the headers say */
+    bool m_chunked;
+    bool m_close;               /* The server closes the connection after the response */
+    bool m_has_length;
+    uint32_t m_length;          /* Bytes left of the body or of the chunk */
+    uint32_t m_body_len;
+    char m_line[32];            /* The beginning of the line being parsed */
+    uint8_t m_line_len;
+    ESP8266HTTPSink m_sink;
+    void *m_sink_arg;
+};
+
+#endif /* #ifndef __ESP8266HTTP_H__ */
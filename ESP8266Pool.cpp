@@ -0,0 +1,227 @@
+/**
+ * @file ESP8266Pool.cpp
+ * @brief The implementation of class ESP8266Pool.
+ * @author WeeESP8266 contributors<https://github.com/igorzel/ITEADLIB_Arduino_WeeESP8266>
+ * @date 2026.10
+ *
+ * @par Copyright:
+ * Copyright (c) 2026 WeeESP8266 contributors. \n\n
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version. \n\n
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "ESP8266Pool.h"
+
+ESP8266Pool::ESP8266Pool(void)
+{
+    memset(m_module, 0, sizeof(m_module));
+    m_count = 0;
+    m_next = 0;
+    m_data_cb = NULL;
+    m_data_arg = NULL;
+    m_link_cb = NULL;
+    m_link_arg = NULL;
+}
+
+bool ESP8266Pool::add(ESP8266 &wifi)
+{
+    Module *m;
+
+    if (m_count == ESP8266POOL_MODULES) {
+        return false;
+    }
+    m = &m_module[m_count];
+    m->pool = this;
+    m->wifi = &wifi;
+    m->index = m_count;
+    m->inside = false;
+    wifi.setDataCallback(onData, m);
+    wifi.setLinkCallback(onLink, m);
+    wifi.setIdleCallback(onIdle, m);
+    m_count++;
+    return true;
+}
+
+uint8_t ESP8266Pool::getModuleCount(void)
+{
+    return m_count;
+}
+
+ESP8266 *ESP8266Pool::getModule(uint8_t id)
+{
+    if (id >= m_count * ESP8266POOL_MUX) {
+        return NULL;
+    }
+    return m_module[id / ESP8266POOL_MUX].wifi;
+}
+
+uint8_t ESP8266Pool::getLinkCount(uint8_t index)
+{
+    uint8_t n = 0;
+
+    if (index >= m_count) {
+        return 0;
+    }
+    for (uint8_t mux_id = 0; mux_id < ESP8266POOL_MUX; mux_id++) {
+        if (m_module[index].wifi->isLinkOpen(mux_id)) {
+            n++;
+        }
+    }
+    return n;
+}
+
+int8_t ESP8266Pool::createTCP(String addr, uint32_t port)
+{
+    int8_t id = pick();
+
+    if (id < 0 || !getModule(id)->createTCP(id % ESP8266POOL_MUX, addr, port)) {
+        return -1;
+    }
+    return id;
+}
+
+bool ESP8266Pool::releaseTCP(uint8_t id)
+{
+    ESP8266 *wifi = getModule(id);
+    return wifi && wifi->releaseTCP(id % ESP8266POOL_MUX);
+}
+
+int8_t ESP8266Pool::registerUDP(String addr, uint32_t port)
+{
+    int8_t id = pick();
+
+    if (id < 0 || !getModule(id)->registerUDP(id % ESP8266POOL_MUX, addr, port)) {
+        return -1;
+    }
+    return id;
+}
+
+bool ESP8266Pool::unregisterUDP(uint8_t id)
+{
+    ESP8266 *wifi = getModule(id);
+    return wifi && wifi->unregisterUDP(id % ESP8266POOL_MUX);
+}
+
+bool ESP8266Pool::send(uint8_t id, const uint8_t *buffer, uint32_t len)
+{
+    ESP8266 *wifi = getModule(id);
+    return wifi && wifi->send(id % ESP8266POOL_MUX, buffer, len);
+}
+
+bool ESP8266Pool::sendAsync(uint8_t id, const uint8_t *buffer, uint32_t len)
+{
+    ESP8266 *wifi = getModule(id);
+    return wifi && wifi->sendAsync(id % ESP8266POOL_MUX, buffer, len);
+}
+
+void ESP8266Pool::poll(void)
+{
+    Module *m;
+    uint8_t i;
+
+    if (m_count == 0) {
+        return;
+    }
+    for (i = 0; i < m_count; i++) {
+        m = &m_module[(m_next + i) % m_count];
+        if (!m->inside) {
+            m->inside = true;
+            m->wifi->poll();
+            m->inside = false;
+        }
+    }
+    m_next = (m_next + 1) % m_count;
+}
+
+void ESP8266Pool::setDataCallback(ESP8266DataCallback cb, void *arg)
+{
+    m_data_cb = cb;
+    m_data_arg = arg;
+}
+
+void ESP8266Pool::setLinkCallback(ESP8266LinkCallback cb, void *arg)
+{
+    m_link_cb = cb;
+    m_link_arg = arg;
+}
+
+int8_t ESP8266Pool::pick(void)
+{
+    int8_t best = -1;
+    uint8_t best_links = ESP8266POOL_MUX;
+    uint8_t links;
+
+    for (uint8_t i = 0; i < m_count; i++) {
+        links = getLinkCount(i);
+        if (links < best_links) {
+            best = i;
+            best_links = links;
+        }
+    }
+    if (best < 0) {
+        return -1;
+    }
+    for (uint8_t mux_id = 0; mux_id < ESP8266POOL_MUX; mux_id++) {
+        if (!m_module[best].wifi->isLinkOpen(mux_id)) {
+            return best * ESP8266POOL_MUX + mux_id;
+        }
+    }
+    return -1;
+}
+
+void ESP8266Pool::onData(uint8_t mux_id, const uint8_t *data, uint32_t len, void *arg)
+{
+    Module *m = (Module *)arg;
+    ESP8266Pool *pool = m->pool;
+
+    bool inside = m->inside;
+
+    if (pool->m_data_cb) {
+        /* The sketch may call a blocking method of another module from here. */
+        m->inside = true;
+        pool->m_data_cb(m->index * ESP8266POOL_MUX + mux_id, data, len, pool->m_data_arg);
+        m->inside = inside;
+    }
+}
+
+void ESP8266Pool::onLink(uint8_t mux_id, bool connected, void *arg)
+{
+    Module *m = (Module *)arg;
+    ESP8266Pool *pool = m->pool;
+
+    bool inside = m->inside;
+
+    if (pool->m_link_cb) {
+        m->inside = true;
+        pool->m_link_cb(m->index * ESP8266POOL_MUX + mux_id, connected, pool->m_link_arg);
+        m->inside = inside;
+    }
+}
+
+void ESP8266Pool::onIdle(void *arg)
+{
+    Module *m = (Module *)arg;
+    ESP8266Pool *pool = m->pool;
+    bool inside = m->inside;
+    Module *other;
+
+    /* Modules already on the stack, this one included, are left alone. */
+    m->inside = true;
+    for (uint8_t i = 0; i < pool->m_count; i++) {
+        other = &pool->m_module[i];
+        if (!other->inside) {
+            other->inside = true;
+            other->wifi->poll();
+            other->inside = false;
+        }
+    }
+    m->inside = inside;
+}
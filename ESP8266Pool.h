@@ -0,0 +1,211 @@
+/**
+ * @file ESP8266Pool.h
+ * @brief The definition of class ESP8266Pool.
+ * @author WeeESP8266 contributors<https://github.com/igorzel/ITEADLIB_Arduino_WeeESP8266>
+ * @date 2026.10
+ *
+ * @par Copyright:
+ * Copyright (c) 2026 WeeESP8266 contributors. \n\n
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version. \n\n
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#ifndef __ESP8266POOL_H__
+#define __ESP8266POOL_H__
+
+#include "ESP8266.h"
+
+/*
+ * The most modules a pool takes.
+ */
+#ifndef ESP8266POOL_MODULES
+#define ESP8266POOL_MODULES     (4)
+#endif
+
+/*
+ * Links of each module(mux_id 0-4).
+ */
+#define ESP8266POOL_MUX         (5)
+
+/* Link ids are int8_t. */
+#if ESP8266POOL_MODULES < 1 || ESP8266POOL_MODULES * ESP8266POOL_MUX > 127
+#error "ESP8266POOL_MODULES must be from 1 to 25"
+#endif
+
+/**
+ * Several ESP8266, each on its own UART, used as one.
+ *
+ * The links of all modules share one id space: the link id is
+ * module * ESP8266POOL_MUX + mux_id, so link ids 0-4 are those of the first
+ * module added, 5-9 those of the second and so on. A new connection goes to
+ * the module with the fewest links open. Data and connection events of all
+ * modules go to one callback with the link id.
+ *
+ * While a blocking call waits on one module, the pool polls the others, so
+ * their data keeps coming to the callback during a long connect or send.
+ */
+class ESP8266Pool {
+ public:
+    /**
+     * Constructor.
+     */
+    ESP8266Pool(void);
+
+    /**
+     * Add a module.
+     *
+     * The pool takes over the data, link and idle callbacks of the module.
+     *
+     * @param wifi - the ESP8266 to add, joined to an AP and in multiple mode
+     *  (see enableMUX).
+     * @retval true - success.
+     * @retval false - ESP8266POOL_MODULES are added already.
+     */
+    bool add(ESP8266 &wifi);
+
+    /**
+     * Get the number of modules added.
+     */
+    uint8_t getModuleCount(void);
+
+    /**
+     * Get the module of a link.
+     *
+     * @param id - the link id.
+     * @return the module or NULL if id is out of range.
+     */
+    ESP8266 *getModule(uint8_t id);
+
+    /**
+     * Get the number of links open on a module.
+     *
+     * @param index - the module, in the order added.
+     */
+    uint8_t getLinkCount(uint8_t index);
+
+    /**
+     * Create TCP connection on the module with the fewest links open.
+     *
+     * @param addr - the IP or domain name of the target host.
+     * @param port - the port number of the target host.
+     * @return the link id or -1 for failure.
+     */
+    int8_t createTCP(String addr, uint32_t port);
+
+    /**
+     * Release TCP connection.
+     *
+     * @param id - the link id.
+     * @retval true - success.
+     * @retval false - failure.
+     */
+    bool releaseTCP(uint8_t id);
+
+    /**
+     * Register UDP port number on the module with the fewest links open.
+     *
+     * @param addr - the IP or domain name of the target host.
+     * @param port - the port number of the target host.
+     * @return the link id or -1 for failure.
+     */
+    int8_t registerUDP(String addr, uint32_t port);
+
+    /**
+     * Unregister UDP port number.
+     *
+     * @param id - the link id.
+     * @retval true - success.
+     * @retval false - failure.
+     */
+    bool unregisterUDP(uint8_t id);
+
+    /**
+     * Send data based on one of TCP or UDP builded already.
+     *
+     * @param id - the link id.
+     * @param buffer - the buffer of data to send.
+     * @param len - the length of data to send.
+     * @retval true - success.
+     * @retval false - failure.
+     */
+    bool send(uint8_t id, const uint8_t *buffer, uint32_t len);
+
+    /**
+     * Send data without waiting.
+     *
+     * Only the module of the link has to be idle, so data can be sent on
+     * all modules at once. The result is passed to the command callback of
+     * that module with ESP8266_CMD_CIPSEND.
+     *
+     * @param id - the link id.
+     * @param buffer - the buffer of data to send, kept until the result.
+     * @param len - the length of data to send.
+     * @retval true - submitted.
+     * @retval false - the module is busy.
+     */
+    bool sendAsync(uint8_t id, const uint8_t *buffer, uint32_t len);
+
+    /**
+     * Process data from all modules without waiting.
+     *
+     * @see void ESP8266::poll(void);
+     */
+    void poll(void);
+
+    /**
+     * Set the function called with data received by any module.
+     *
+     * @param cb - the callback, called with the link id(NULL to remove).
+     * @param arg - passed to the callback.
+     */
+    void setDataCallback(ESP8266DataCallback cb, void *arg = NULL);
+
+    /**
+     * Set the function called when a link of any module is connected or closed.
+     *
+     * @param cb - the callback, called with the link id(NULL to remove).
+     * @param arg - passed to the callback.
+     */
+    void setLinkCallback(ESP8266LinkCallback cb, void *arg = NULL);
+
+ private:
+    /*
+     * One module, passed to its callbacks.
+     */
+    struct Module {
+        ESP8266Pool *pool;
+        ESP8266 *wifi;
+        uint8_t index;
+        bool inside;            /* Its poll or a blocking call of it is in progress */
+    };
+
+    /*
+     * Find the module with the fewest links open and a free mux_id on it.
+     *
+     * @return the link id or -1 if all links are open.
+     */
+    int8_t pick(void);
+
+    static void onData(uint8_t mux_id, const uint8_t *data, uint32_t len, void *arg);
+    static void onLink(uint8_t mux_id, bool connected, void *arg);
+    static void onIdle(void *arg);
+
+    Module m_module[ESP8266POOL_MODULES];
+    uint8_t m_count;
+    uint8_t m_next;             /* Where the next poll starts, so no module goes first always */
+
+    ESP8266DataCallback m_data_cb;
+    void *m_data_arg;
+    ESP8266LinkCallback m_link_cb;
+    void *m_link_arg;
+};
+
+#endif /* #ifndef __ESP8266POOL_H__ */
@@ -0,0 +1,81 @@
+/**
+ * @example HTTPKeepAlive.ino
+ * @brief The HTTPKeepAlive demo of library WeeESP8266.
+ * @author WeeESP8266 contributors<https://github.com/igorzel/ITEADLIB_Arduino_WeeESP8266>
+ * @date 2026.10
+ *
+ * @par Copyright:
+ * Copyright (c) 2026 WeeESP8266 contributors. \n\n
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version. \n\n
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "ESP8266.h"
+#include "ESP8266HTTP.h"
+
+#define SSID        "ITEAD"
+#define PASSWORD    "12345678"
+#define HOST_NAME   "www.baidu.com"
+#define HOST_PORT   (80)
+
+ESP8266 wifi(Serial1);
+ESP8266HTTP http(wifi);
+
+void onBody(const uint8_t *data, uint32_t len, void *arg)
+{
+    Serial.write(data, len);
+}
+
+void setup(void)
+{
+    Serial.begin(9600);
+    Serial.print("setup begin\r\n");
+
+    if (wifi.setOprToStation()) {
+        Serial.print("to station ok\r\n");
+    } else {
+        Serial.print("to station err\r\n");
+    }
+
+    if (wifi.joinAP(SSID, PASSWORD)) {
+        Serial.print("Join AP success\r\n");
+    } else {
+        Serial.print("Join AP failure\r\n");
+    }
+
+    if (wifi.enableMUX()) {
+        Serial.print("multiple ok\r\n");
+    } else {
+        Serial.print("multiple err\r\n");
+    }
+
+    Serial.print("setup end\r\n");
+}
+
+void loop(void)
+{
+    unsigned long start = millis();
+
+    /* Only the first request opens a connection. */
+    int status = http.get(HOST_NAME, HOST_PORT, "/", onBody, NULL);
+
+    Serial.print("\r\nstatus:");
+    Serial.print(status);
+    Serial.print(" body:");
+    Serial.print(http.getBodyLength());
+    Serial.print(" time:");
+    Serial.print(millis() - start);
+    Serial.print(" connections:");
+    Serial.println(http.getConnectCount());
+
+    delay(5000);
+}
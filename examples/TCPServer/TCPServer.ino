@@ -75,12 +75,18 @@ void loop(void)
     uint8_t mux_id;
     uint32_t len = wifi.recv(&mux_id, buffer, sizeof(buffer), 100);
     if (len > 0) {
-        Serial.print("Status:[");
-        Serial.print(wifi.getIPStatus().c_str());
-        Serial.println("]");
-        
+        const ESP8266LinkStatus *link = wifi.getLinkStatus(mux_id);
         Serial.print("Received from :");
         Serial.print(mux_id);
+        if (link) {
+            Serial.print("(");
+            for (uint8_t i = 0; i < 4; i++) {
+                Serial.print(link->ip[i]);
+                Serial.print(i < 3 ? "." : ":");
+            }
+            Serial.print(link->remote_port);
+            Serial.print(")");
+        }
         Serial.print("[");
         for(uint32_t i = 0; i < len; i++) {
             Serial.print((char)buffer[i]);
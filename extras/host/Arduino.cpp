@@ -0,0 +1,63 @@
+/**
+ * @file Arduino.cpp
+ * @brief Virtual clock of the host Arduino core.
+ *
+ * @par Copyright:
+ * Copyright (c) 2026 WeeESP8266 contributors. \n\n
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ */
+#include "Arduino.h"
+
+static uint64_t g_now_us = 0;
+
+uint64_t sim_now_us(void)
+{
+    return g_now_us;
+}
+
+void sim_advance_us(uint64_t us)
+{
+    g_now_us += us;
+}
+
+void sim_set_now_us(uint64_t us)
+{
+    if (us > g_now_us) {
+        g_now_us = us;
+    }
+}
+
+/*
+ * Every clock read costs one microsecond so that busy-wait loops which never
+ * touch the UART still terminate.
+ */
+unsigned long millis(void)
+{
+    g_now_us += 1;
+    return (unsigned long)(g_now_us / 1000);
+}
+
+unsigned long micros(void)
+{
+    g_now_us += 1;
+    return (unsigned long)g_now_us;
+}
+
+void delay(unsigned long ms)
+{
+    g_now_us += (uint64_t)ms * 1000;
+    HardwareSerial::serviceAll();
+}
+
+void delayMicroseconds(unsigned int us)
+{
+    g_now_us += us;
+    HardwareSerial::serviceAll();
+}
+
+void yield(void)
+{
+}
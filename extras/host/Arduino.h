@@ -0,0 +1,70 @@
+/**
+ * @file Arduino.h
+ * @brief Minimal Arduino core used to build WeeESP8266 on a host machine.
+ *
+ * Only the parts of the core touched by the library are provided. Time is
+ * virtual: it is owned by the simulator and advances when the driver waits
+ * on the UART, calls delay() or polls millis().
+ *
+ * @par Copyright:
+ * Copyright (c) 2026 WeeESP8266 contributors. \n\n
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ */
+#ifndef __HOST_ARDUINO_H__
+#define __HOST_ARDUINO_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+/*
+ * Flash data is ordinary memory on host. It still goes to a section of its
+ * own, so that "size -A" tells what would stay out of SRAM on AVR.
+ */
+#define PROGMEM                 __attribute__((section(".progmem.data")))
+#define PSTR(s)                 (__extension__({ static const char __c[] PROGMEM = (s); &__c[0]; }))
+#define pgm_read_byte(addr)     (*(const uint8_t *)(addr))
+#define pgm_read_word(addr)     (*(const uint16_t *)(addr))
+#define strlen_P                strlen
+#define strcpy_P                strcpy
+#define strcat_P                strcat
+#define strcmp_P                strcmp
+#define memcmp_P                memcmp
+#define memcpy_P                memcpy
+#define strncmp_P               strncmp
+#define strncasecmp_P           strncasecmp
+#define strstr_P                strstr
+
+class __FlashStringHelper;
+#define F(s)                    (reinterpret_cast<const __FlashStringHelper *>(PSTR(s)))
+
+#define DEC 10
+#define HEX 16
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+unsigned long millis(void);
+unsigned long micros(void);
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield(void);
+
+/*
+ * Host-only hooks of the virtual clock.
+ */
+uint64_t sim_now_us(void);
+void sim_advance_us(uint64_t us);
+void sim_set_now_us(uint64_t us);
+
+#include "WString.h"
+#include "Print.h"
+#include "Stream.h"
+#include "HardwareSerial.h"
+
+#endif /* #ifndef __HOST_ARDUINO_H__ */
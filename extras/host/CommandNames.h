@@ -0,0 +1,30 @@
+/**
+ * @file CommandNames.h
+ * @brief Names of ESP8266_CMD_* for the host tools.
+ *
+ * @par Copyright:
+ * Copyright (c) 2026 WeeESP8266 contributors. \n\n
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ */
+#ifndef __COMMANDNAMES_H__
+#define __COMMANDNAMES_H__
+
+#include "ESP8266.h"
+
+/* Indexed by ESP8266_CMD_* */
+static const char *const COMMAND_NAMES[ESP8266_CMD_COUNT] = {
+    "", "AT", "RST", "GMR", "CWMODE", "CWJAP", "CWLAP", "CWQAP", "CWSAP", "CWLIF",
+    "CIPSTATUS", "CIPSTART", "CIPSEND", "CIPCLOSE", "CIFSR", "CIPMUX", "CIPSERVER",
+    "CIPSTO", "CIPMODE", "UART", "CWLAPOPT", "CIPSENDBUF", "CIPSTA", "CWDHCP",
+    "CIPDOMAIN",
+};
+
+static inline const char *commandName(unsigned cmd)
+{
+    return cmd < ESP8266_CMD_COUNT ? COMMAND_NAMES[cmd] : "?";
+}
+
+#endif /* #ifndef __COMMANDNAMES_H__ */
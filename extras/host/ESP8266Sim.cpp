@@ -0,0 +1,715 @@
+/**
+ * @file ESP8266Sim.cpp
+ * @brief Scripted ESP8266 AT firmware emulator for host builds.
+ *
+ * @par Copyright:
+ * Copyright (c) 2026 WeeESP8266 contributors. \n\n
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ */
+#include <algorithm>
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "ESP8266Sim.h"
+
+#define LOCAL_IP    "192.168.1.100"
+#define LOCAL_MAC   "18:fe:34:9a:00:01"
+
+ESP8266Sim::ESP8266Sim(HardwareSerial &uart)
+    : cmd_latency_us(300), rtt_us(20000), dns_us(30000), join_us(3000000),
+      join_scan_us(1500000), dhcp_us(1000000), scan_us(1500000), boot_us(900000), pack_us(20000), guard_us(1000000),
+      echo_payload(true), max_baud(0), sendbuf_segments(8), first_segment(1), sendbuf_fail(false), banner(true), quote_domain(false), legacy(false), responder(NULL), responder_arg(NULL),
+      commands(0), busy_replies(0), payload_in(0), payload_out(0), connects(0), sendbuf_refused(0), lookups(0),
+      m_uart(&uart), m_baud(0), m_boot_baud(0), m_ready_at(0), m_busy_until(0), m_mux(0), m_cwmode(1),
+      m_lap_sort(false), m_lap_mask(0x1F),
+      m_joined(false), m_ap(0), m_server_port(0), m_next_local_port(4096),
+      m_cipmode(0), m_passthrough(false), m_pt_last(0), m_pt_silence(0),
+      m_send_id(-1), m_send_remaining(0), m_send_buffered(false)
+{
+    static const ESP8266SimAP defaults[] = {
+        { 3, "ITEAD",        -45, "c8:3a:35:01:02:03", 1 },
+        { 4, "HomeNet",      -61, "00:1d:7e:aa:bb:cc", 6 },
+        { 3, "Office-5F",    -70, "14:cc:20:10:20:30", 11 },
+        { 0, "GuestOpen",    -82, "90:94:e4:11:22:33", 6 },
+        { 3, "Lab-2.4G",     -55, "b0:48:7a:44:55:66", 1 },
+        { 4, "Warehouse",    -88, "f8:1a:67:77:88:99", 13 },
+        { 2, "Legacy-WPA",   -76, "00:14:6c:de:ad:01", 3 },
+        { 3, "Printer-AP",   -67, "a0:f3:c1:be:ef:02", 9 },
+    };
+    for (size_t i = 0; i < sizeof(defaults) / sizeof(defaults[0]); i++) {
+        aps.push_back(defaults[i]);
+    }
+    for (int i = 0; i < ESP8266SIM_LINKS; i++) {
+        m_links[i].open = false;
+        m_links[i].server = false;
+        m_links[i].port = 0;
+        m_links[i].local_port = 0;
+    }
+    uart.attach(this);
+}
+
+void ESP8266Sim::reply(uint64_t t, const std::string &s)
+{
+    unsigned long rate = m_baud ? m_baud : m_uart->baud();
+    if (max_baud && rate > max_baud) {
+        /* Too fast for the receiver: it cannot frame the bytes. */
+        std::string bad(s.size(), (char)0xff);
+        m_uart->deliver((const uint8_t *)bad.data(), bad.size(), t);
+        return;
+    }
+    m_uart->deliver((const uint8_t *)s.data(), s.size(), t);
+}
+
+void ESP8266Sim::push(uint8_t mux_id, const uint8_t *data, size_t len, uint64_t delay_us)
+{
+    pushAt(mux_id, data, len, sim_now_us() + delay_us);
+}
+
+void ESP8266Sim::pushAt(uint8_t mux_id, const uint8_t *data, size_t len, uint64_t at)
+{
+    char head[32];
+    if (m_passthrough) {
+        /* Raw in passthrough, like the echo. */
+        head[0] = '\0';
+    } else if (m_mux) {
+        snprintf(head, sizeof(head), "\r\n+IPD,%u,%u:", mux_id, (unsigned)len);
+    } else {
+        snprintf(head, sizeof(head), "\r\n+IPD,%u:", (unsigned)len);
+    }
+    std::string frame(head);
+    frame.append((const char *)data, len);
+    reply(at, frame);
+    payload_out += len;
+}
+
+void ESP8266Sim::accept(uint8_t mux_id, const char *ip, uint32_t port, uint64_t delay_us)
+{
+    char buf[16];
+    Link &l = m_links[mux_id];
+    l.open = true;
+    l.server = true;
+    l.type = "TCP";
+    l.ip = ip;
+    l.port = port;
+    l.local_port = m_server_port;
+    snprintf(buf, sizeof(buf), "%u,CONNECT\r\n", mux_id);
+    reply(sim_now_us() + delay_us, buf);
+}
+
+void ESP8266Sim::remoteClose(uint8_t mux_id, uint64_t delay_us)
+{
+    closeAt(mux_id, sim_now_us() + delay_us);
+}
+
+void ESP8266Sim::closeAt(uint8_t mux_id, uint64_t at)
+{
+    char buf[16];
+    m_links[mux_id].open = false;
+    if (m_mux) {
+        snprintf(buf, sizeof(buf), "%u,CLOSED\r\n", mux_id);
+    } else {
+        snprintf(buf, sizeof(buf), "CLOSED\r\n");
+    }
+    reply(at, buf);
+}
+
+std::string ESP8266Sim::takeSent(uint8_t mux_id)
+{
+    std::string s;
+    if (m_passthrough && mux_id == 0 && m_pt_buf != "+++") {
+        passthroughFlush(sim_now_us());
+    }
+    s.swap(m_links[mux_id].sent);
+    return s;
+}
+
+void ESP8266Sim::onByte(uint8_t c, uint64_t t)
+{
+    if (t < m_ready_at) {
+        return; /* Rebooting */
+    }
+    if (m_passthrough && !passthroughByte(c, t)) {
+        return;
+    }
+    if (m_send_remaining) {
+        m_send_buf += (char)c;
+        if (--m_send_remaining == 0) {
+            finishSend(t);
+        }
+        return;
+    }
+    if (c == '\n') {
+        std::string line;
+        line.swap(m_line);
+        if (!line.empty() && line[line.size() - 1] == '\r') {
+            line.erase(line.size() - 1);
+        }
+        if (line.empty()) {
+            return;
+        }
+        if (t < m_busy_until) {
+            busy_replies++;
+            reply(t + cmd_latency_us, "busy p...\r\n");
+            return;
+        }
+        execute(line, t);
+        return;
+    }
+    m_line += (char)c;
+}
+
+/*
+ * Passthrough: bytes are packed until pack_us of silence or ESP8266SIM_SEND_MAX bytes.
+ * "+++" alone, with guard_us of silence on both sides, leaves the mode.
+ * Return true if the byte ended passthrough and is an AT command byte.
+ */
+bool ESP8266Sim::passthroughByte(uint8_t c, uint64_t t)
+{
+    onIdle(t);
+    if (!m_passthrough) {
+        return true;
+    }
+    if (m_pt_buf.empty()) {
+        m_pt_silence = t - m_pt_last;
+    }
+    m_pt_buf += (char)c;
+    m_pt_last = t;
+    if (m_pt_buf.size() >= ESP8266SIM_SEND_MAX) {
+        passthroughFlush(t);
+    }
+    return false;
+}
+
+void ESP8266Sim::later(uint64_t at, const std::string &s)
+{
+    m_later.insert(std::make_pair(at, s));
+}
+
+void ESP8266Sim::onIdle(uint64_t now)
+{
+    while (!m_later.empty() && m_later.begin()->first <= now) {
+        reply(m_later.begin()->first, m_later.begin()->second);
+        m_later.erase(m_later.begin());
+    }
+    if (!m_passthrough || m_pt_buf.empty()) {
+        return;
+    }
+    if (m_pt_buf == "+++") {
+        if (m_pt_silence >= guard_us && now - m_pt_last >= guard_us) {
+            m_pt_buf.clear();
+            m_passthrough = false;
+        }
+    } else if (now - m_pt_last >= pack_us) {
+        passthroughFlush(m_pt_last + pack_us);
+    }
+}
+
+void ESP8266Sim::passthroughFlush(uint64_t t)
+{
+    Link &l = m_links[0];
+    if (m_pt_buf.empty()) {
+        return;
+    }
+    l.sent += m_pt_buf;
+    payload_in += m_pt_buf.size();
+    if (echo_payload && l.open) {
+        reply(t + rtt_us, m_pt_buf);
+        payload_out += m_pt_buf.size();
+    }
+    m_pt_buf.clear();
+}
+
+void ESP8266Sim::finishSend(uint64_t t)
+{
+    char buf[32];
+    Link &l = m_links[m_send_id];
+    size_t len = m_send_buf.size();
+    
+    snprintf(buf, sizeof(buf), "\r\nRecv %u bytes\r\n", (unsigned)len);
+    reply(t + cmd_latency_us, buf);
+    if (m_send_buffered) {
+        /* Sent from the buffer in order, one RTT after it came. */
+        uint64_t ack = t + rtt_us;
+        if (!l.unacked.empty() && l.unacked.back() > ack) {
+            ack = l.unacked.back();
+        }
+        l.unacked.push_back(ack);
+        snprintf(buf, sizeof(buf), "%d,%u,%s\r\n", m_send_id, l.seg_next - 1, sendbuf_fail ? "SEND FAIL" : "SEND OK");
+        later(ack, buf);
+    } else {
+        reply(t + rtt_us, "\r\nSEND OK\r\n");
+    }
+    l.sent += m_send_buf;
+    payload_in += len;
+    if (responder && l.open) {
+        bool close = false;
+        std::string out = responder((uint8_t)m_send_id, m_send_buf, &close, responder_arg);
+        /* One +IPD per TCP segment. */
+        for (size_t i = 0; i < out.size(); i += 1460) {
+            size_t n = out.size() - i < 1460 ? out.size() - i : 1460;
+            pushAt((uint8_t)m_send_id, (const uint8_t *)out.data() + i, n, t + rtt_us);
+        }
+        if (close) {
+            closeAt((uint8_t)m_send_id, t + rtt_us);
+        }
+    } else if (echo_payload && l.open) {
+        pushAt((uint8_t)m_send_id, (const uint8_t *)m_send_buf.data(), len, t + rtt_us);
+    }
+    m_send_buf.clear();
+    m_send_id = -1;
+    m_busy_until = t + (m_send_buffered ? cmd_latency_us : rtt_us);
+    m_send_buffered = false;
+}
+
+void ESP8266Sim::reboot(uint64_t t)
+{
+    static const uint8_t garbage[] = {
+        0x00, 0xe0, 0x1c, 0x72, 0x8c, 0xfe, 0x92, 0x6c, 0x0e, 0x84, 0xf2, 0x7c,
+        0x0c, 0xec, 0x70, 0x0c, 0x82, 0x1e, 0x8c, 0xe2, 0x0c, 0x60, 0x9c, 0xff,
+    };
+    m_ready_at = t + boot_us;
+    m_uart->deliver(garbage, sizeof(garbage), t + 100000);
+    reply(m_ready_at, banner ? "\r\n[Vendor:www.ai-thinker.com Version:0.9.2.4]\r\n\r\nready\r\n"
+        : "\r\n[Vendor:www.ai-thinker.com Version:0.9.2.4]\r\n");
+    m_baud = m_boot_baud;
+    m_mux = 0;
+    m_cipmode = 0;
+    m_passthrough = false;
+    m_pt_buf.clear();
+    m_server_port = 0;
+    m_line.clear();
+    m_send_remaining = 0;
+    m_send_buffered = false;
+    m_later.clear();
+    m_static_ip.clear();
+    for (int i = 0; i < ESP8266SIM_LINKS; i++) {
+        m_links[i].open = false;
+    }
+}
+
+bool ESP8266Sim::strongerAP(const ESP8266SimAP &a, const ESP8266SimAP &b)
+{
+    return a.rssi > b.rssi;
+}
+
+std::string ESP8266Sim::lapFields(const ESP8266SimAP &ap) const
+{
+    char buf[64];
+    std::string out;
+    
+    for (int bit = 0; bit < 5; bit++) {
+        if (!(m_lap_mask & (1 << bit))) {
+            continue;
+        }
+        switch (bit) {
+        case 0: snprintf(buf, sizeof(buf), "%d", ap.ecn); break;
+        case 1: snprintf(buf, sizeof(buf), "\"%s\"", ap.ssid.c_str()); break;
+        case 2: snprintf(buf, sizeof(buf), "%d", ap.rssi); break;
+        case 3: snprintf(buf, sizeof(buf), "\"%s\"", ap.mac.c_str()); break;
+        default: snprintf(buf, sizeof(buf), "%d", ap.channel); break;
+        }
+        if (!out.empty()) {
+            out += ',';
+        }
+        out += buf;
+    }
+    return out;
+}
+
+std::vector<std::string> ESP8266Sim::splitArgs(const std::string &s)
+{
+    std::vector<std::string> args;
+    std::string cur;
+    bool quoted = false;
+    for (size_t i = 0; i < s.size(); i++) {
+        char c = s[i];
+        if (c == '"') {
+            quoted = !quoted;
+        } else if (c == ',' && !quoted) {
+            args.push_back(cur);
+            cur.clear();
+        } else {
+            cur += c;
+        }
+    }
+    args.push_back(cur);
+    return args;
+}
+
+bool ESP8266Sim::isNumericIP(const std::string &host)
+{
+    for (size_t i = 0; i < host.size(); i++) {
+        if ((host[i] < '0' || host[i] > '9') && host[i] != '.') {
+            return false;
+        }
+    }
+    return !host.empty();
+}
+
+std::string ESP8266Sim::resolve(const std::string &host)
+{
+    if (host.compare(0, 3, "bad") == 0) {
+        return "";
+    }
+    std::map<std::string, std::string>::const_iterator it = hosts.find(host);
+    return it != hosts.end() ? it->second : "93.184.216.34";
+}
+
+void ESP8266Sim::execute(const std::string &line, uint64_t t)
+{
+    std::string echo = line + "\r\r\n";
+    std::string name = line;
+    std::string params;
+    bool query = false;
+    bool set = false;
+    uint64_t at = t + cmd_latency_us;
+    char buf[160];
+    
+    size_t eq = line.find('=');
+    if (eq != std::string::npos) {
+        name = line.substr(0, eq);
+        params = line.substr(eq + 1);
+        set = true;
+    } else if (!line.empty() && line[line.size() - 1] == '?') {
+        name = line.substr(0, line.size() - 1);
+        query = true;
+    }
+    std::vector<std::string> args = splitArgs(params);
+    commands++;
+    m_busy_until = at;
+    
+    if (name == "AT" || name == "ATE1") {
+        reply(at, echo + "\r\nOK\r\n");
+    } else if (name == "AT+CWQAP") {
+        m_joined = false;
+        m_static_ip.clear();
+        reply(at, echo + "\r\nOK\r\n");
+    } else if (name == "AT+RST") {
+        reply(at, echo + "\r\nOK\r\n");
+        reboot(at);
+    } else if (name == "AT+GMR") {
+        reply(at, echo + "0018000902\r\n\r\nOK\r\n");
+    } else if (name == "AT+CWMODE" && query) {
+        snprintf(buf, sizeof(buf), "+CWMODE:%d\r\n\r\nOK\r\n", m_cwmode);
+        reply(at, echo + buf);
+    } else if (name == "AT+CWMODE" && set) {
+        int mode = atoi(params.c_str());
+        if (mode < 1 || mode > 3) {
+            reply(at, echo + "\r\nERROR\r\n");
+        } else if (mode == m_cwmode) {
+            reply(at, echo + "no change\r\n");
+        } else {
+            m_cwmode = mode;
+            reply(at, echo + "\r\nOK\r\n");
+        }
+    } else if (name == "AT+CWMODE_CUR" && set && !legacy) {
+        int mode = atoi(params.c_str());
+        if (mode < 1 || mode > 3) {
+            reply(at, echo + "\r\nERROR\r\n");
+        } else {
+            m_cwmode = mode;
+            reply(at, echo + "\r\nOK\r\n");
+        }
+    } else if ((name == "AT+CWJAP" || (name == "AT+CWJAP_CUR" && !legacy)) && set) {
+        /* A BSSID skips the scan, a static address DHCP. */
+        bool found = false;
+        uint64_t took = join_us;
+        for (size_t i = 0; i < aps.size() && !found; i++) {
+            if (args.size() >= 2 && aps[i].ssid == args[0]
+                && (args.size() < 3 || aps[i].mac == args[2])) {
+                found = true;
+                m_ap = i;
+            }
+        }
+        if (args.size() >= 3) {
+            took -= join_scan_us;
+        }
+        if (!m_static_ip.empty()) {
+            took -= dhcp_us;
+        }
+        reply(at, echo);
+        m_busy_until = at + took;
+        if (found && m_cwmode != 2) {
+            m_joined = true;
+            m_ssid = args[0];
+            reply(at + took, m_static_ip.empty() ? "WIFI CONNECTED\r\nWIFI GOT IP\r\n\r\nOK\r\n"
+                : "WIFI CONNECTED\r\n\r\nOK\r\n");
+        } else {
+            m_joined = false;
+            reply(at + took, "+CWJAP:3\r\n\r\nFAIL\r\n");
+        }
+    } else if (name == "AT+CWJAP" && query) {
+        if (m_joined) {
+            const ESP8266SimAP &ap = aps[m_ap];
+            snprintf(buf, sizeof(buf), "+CWJAP:\"%s\",\"%s\",%d,%d\r\n\r\nOK\r\n",
+                ap.ssid.c_str(), ap.mac.c_str(), ap.channel, ap.rssi);
+            reply(at, echo + buf);
+        } else {
+            reply(at, echo + "No AP\r\n\r\nOK\r\n");
+        }
+    } else if (name == "AT+CIPSTA" && query) {
+        snprintf(buf, sizeof(buf), "+CIPSTA:ip:\"%s\"\r\n+CIPSTA:gateway:\"192.168.1.1\"\r\n"
+            "+CIPSTA:netmask:\"255.255.255.0\"\r\n\r\nOK\r\n",
+            m_static_ip.empty() ? LOCAL_IP : m_static_ip.c_str());
+        reply(at, echo + buf);
+    } else if (name == "AT+CIPSTA_CUR" && set && !legacy) {
+        if (args.empty() || !isNumericIP(args[0])) {
+            reply(at, echo + "\r\nERROR\r\n");
+        } else {
+            m_static_ip = args[0];
+            reply(at, echo + "\r\nOK\r\n");
+        }
+    } else if (name == "AT+CWDHCP_CUR" && set && !legacy) {
+        if (args.size() == 2 && atoi(args[1].c_str())) {
+            m_static_ip.clear();
+        }
+        reply(at, echo + "\r\nOK\r\n");
+    } else if (name == "AT+CIPDOMAIN" && set && !legacy) {
+        std::string ip = args.empty() ? "" : resolve(args[0]);
+        uint64_t done = at + dns_us;
+        reply(at, echo);
+        m_busy_until = done;
+        lookups++;
+        if (!m_joined || ip.empty()) {
+            reply(done, "DNS Fail\r\n\r\nERROR\r\n");
+        } else {
+            std::string q = quote_domain ? "\"" : "";
+            reply(done, "+CIPDOMAIN:" + q + ip + q + "\r\n\r\nOK\r\n");
+        }
+    } else if (name == "AT+CWMODE_CUR" && query && !legacy) {
+        snprintf(buf, sizeof(buf), "+CWMODE_CUR:%d\r\n\r\nOK\r\n", m_cwmode);
+        reply(at, echo + buf);
+    } else if (name == "AT+CWLAPOPT" && set) {
+        if (args.size() != 2) {
+            reply(at, echo + "\r\nERROR\r\n");
+        } else {
+            m_lap_sort = atoi(args[0].c_str()) != 0;
+            m_lap_mask = atoi(args[1].c_str());
+            reply(at, echo + "\r\nOK\r\n");
+        }
+    } else if (name == "AT+CWLAP") {
+        std::vector<ESP8266SimAP> list;
+        std::string out = echo;
+        for (size_t i = 0; i < aps.size(); i++) {
+            if (!set || (args.size() >= 1 && aps[i].ssid == args[0])) {
+                list.push_back(aps[i]);
+            }
+        }
+        if (m_lap_sort) {
+            std::stable_sort(list.begin(), list.end(), strongerAP);
+        }
+        for (size_t i = 0; i < list.size(); i++) {
+            out += "+CWLAP:(" + lapFields(list[i]) + ")\r\n";
+        }
+        out += "\r\nOK\r\n";
+        m_busy_until = at + scan_us;
+        reply(at + scan_us, out);
+    } else if (name == "AT+CWSAP" && set) {
+        reply(at, echo + (args.size() == 4 && m_cwmode != 1 ? "\r\nOK\r\n" : "\r\nERROR\r\n"));
+    } else if (name == "AT+CWLIF") {
+        reply(at, echo + "192.168.4.2,1a:fe:34:00:00:02\r\n\r\nOK\r\n");
+    } else if (name == "AT+CIPSTATUS") {
+        std::string out = echo;
+        bool any = false;
+        for (int i = 0; i < ESP8266SIM_LINKS; i++) {
+            Link &l = m_links[i];
+            if (!l.open) {
+                continue;
+            }
+            any = true;
+            snprintf(buf, sizeof(buf), "+CIPSTATUS:%d,\"%s\",\"%s\",%u,%u,%d\r\n",
+                i, l.type.c_str(), l.ip.c_str(), l.port, l.local_port, l.server ? 1 : 0);
+            out += buf;
+        }
+        snprintf(buf, sizeof(buf), "STATUS:%d\r\n", any ? 3 : (m_joined ? 2 : 5));
+        out.insert(echo.size(), buf);
+        out += "\r\nOK\r\n";
+        reply(at, out);
+    } else if (name == "AT+CIPSTART" && set) {
+        int id = 0;
+        size_t base = 0;
+        if (m_mux) {
+            id = atoi(args[0].c_str());
+            base = 1;
+        }
+        if (args.size() != base + 3 || id < 0 || id >= ESP8266SIM_LINKS) {
+            reply(at, echo + "\r\nERROR\r\n");
+            return;
+        }
+        Link &l = m_links[id];
+        if (l.open) {
+            reply(at, echo + "ALREADY CONNECT\r\n\r\nERROR\r\n");
+            return;
+        }
+        const std::string &type = args[base];
+        const std::string &host = args[base + 1];
+        std::string ip = host;
+        uint64_t done = at;
+        if (!isNumericIP(host)) {
+            ip = resolve(host);
+            done += dns_us;
+            lookups++;
+        }
+        if (type == "TCP") {
+            done += rtt_us;
+        }
+        reply(at, echo);
+        m_busy_until = done;
+        if (!m_joined || ip.empty() || down.count(ip)) {
+            reply(done, "ERROR\r\nCLOSED\r\n");
+            return;
+        }
+        l.open = true;
+        l.server = false;
+        connects++;
+        l.type = type;
+        l.ip = ip;
+        l.port = atoi(args[base + 2].c_str());
+        l.local_port = m_next_local_port++;
+        l.sent.clear();
+        l.seg_next = first_segment;
+        l.unacked.clear();
+        if (m_mux) {
+            snprintf(buf, sizeof(buf), "%d,CONNECT\r\n\r\nOK\r\n", id);
+        } else {
+            snprintf(buf, sizeof(buf), "CONNECT\r\n\r\nOK\r\n");
+        }
+        reply(done, buf);
+    } else if ((name == "AT+UART_CUR" || name == "AT+UART_DEF") && set) {
+        unsigned long rate = strtoul(args[0].c_str(), NULL, 10);
+        if (args.size() != 5 || rate < 110 || rate > 4608000) {
+            reply(at, echo + "\r\nERROR\r\n");
+            return;
+        }
+        /* The reply still goes at the old rate. */
+        reply(at, echo + "\r\nOK\r\n");
+        m_baud = rate;
+        if (name == "AT+UART_DEF") {
+            m_boot_baud = rate;
+        }
+    } else if (name == "AT+CIPMODE" && set) {
+        int mode = atoi(params.c_str());
+        if (mode > 1 || (mode && m_mux)) {
+            reply(at, echo + "\r\nERROR\r\n");
+        } else {
+            m_cipmode = mode;
+            reply(at, echo + "\r\nOK\r\n");
+        }
+    } else if (name == "AT+CIPSEND" && !set) {
+        if (!m_cipmode || m_mux || !m_links[0].open) {
+            reply(at, echo + "\r\nERROR\r\n");
+            return;
+        }
+        reply(at, echo + "\r\nOK\r\n\r\n>");
+        m_passthrough = true;
+        m_pt_buf.clear();
+        m_pt_last = t;
+    } else if (name == "AT+CIPSEND" && set) {
+        int id = 0;
+        int len;
+        if (m_mux) {
+            if (args.size() != 2) {
+                reply(at, echo + "\r\nERROR\r\n");
+                return;
+            }
+            id = atoi(args[0].c_str());
+            len = atoi(args[1].c_str());
+        } else {
+            len = atoi(args[0].c_str());
+        }
+        if (id < 0 || id >= ESP8266SIM_LINKS || !m_links[id].open) {
+            reply(at, echo + "link is not valid\r\n\r\nERROR\r\n");
+            return;
+        }
+        if (len <= 0 || len > ESP8266SIM_SEND_MAX) {
+            reply(at, echo + "\r\nERROR\r\n");
+            return;
+        }
+        reply(at, echo + "\r\nOK\r\n> ");
+        m_send_id = id;
+        m_send_remaining = len;
+        m_send_buf.clear();
+    } else if (name == "AT+CIPSENDBUF" && set) {
+        int id = atoi(args[0].c_str());
+        int len = args.size() == 2 ? atoi(args[1].c_str()) : 0;
+        if (!m_mux || id < 0 || id >= ESP8266SIM_LINKS || !m_links[id].open
+            || len <= 0 || len > ESP8266SIM_SEND_MAX) {
+            reply(at, echo + "\r\nERROR\r\n");
+            return;
+        }
+        Link &l = m_links[id];
+        unsigned acked = l.seg_next - first_segment - (unsigned)l.unacked.size();
+        while (!l.unacked.empty() && l.unacked.front() <= t) {
+            l.unacked.erase(l.unacked.begin());
+            acked++;
+        }
+        if (l.unacked.size() >= sendbuf_segments) {
+            sendbuf_refused++;
+            reply(at, echo + "\r\nERROR\r\n");
+            return;
+        }
+        snprintf(buf, sizeof(buf), "%u,%u\r\n\r\nOK\r\n> ", l.seg_next++, acked);
+        reply(at, echo + buf);
+        m_send_id = id;
+        m_send_remaining = len;
+        m_send_buf.clear();
+        m_send_buffered = true;
+    } else if (name == "AT+CIPCLOSE") {
+        int id = 0;
+        if (m_mux) {
+            id = set ? atoi(params.c_str()) : -1;
+        }
+        if (id == 5) {
+            for (int i = 0; i < ESP8266SIM_LINKS; i++) {
+                m_links[i].open = false;
+            }
+            reply(at, echo + "\r\nOK\r\n");
+        } else if (id < 0 || id >= ESP8266SIM_LINKS || !m_links[id].open) {
+            reply(at, echo + "link is not valid\r\n\r\nERROR\r\n");
+        } else {
+            m_links[id].open = false;
+            if (m_mux) {
+                snprintf(buf, sizeof(buf), "%d,CLOSED\r\n\r\nOK\r\n", id);
+            } else {
+                snprintf(buf, sizeof(buf), "CLOSED\r\n\r\nOK\r\n");
+            }
+            reply(at, echo + buf);
+        }
+    } else if (name == "AT+CIFSR") {
+        snprintf(buf, sizeof(buf), "+CIFSR:STAIP,\"%s\"\r\n+CIFSR:STAMAC,\"" LOCAL_MAC "\"\r\n\r\nOK\r\n",
+            m_static_ip.empty() ? LOCAL_IP : m_static_ip.c_str());
+        reply(at, echo + buf);
+    } else if (name == "AT+CIPMUX" && set) {
+        bool busy = false;
+        for (int i = 0; i < ESP8266SIM_LINKS; i++) {
+            busy = busy || m_links[i].open;
+        }
+        if (busy) {
+            reply(at, echo + "Link is builded\r\n");
+        } else {
+            m_mux = atoi(params.c_str()) ? 1 : 0;
+            reply(at, echo + "\r\nOK\r\n");
+        }
+    } else if (name == "AT+CIPSERVER" && set) {
+        int mode = atoi(args[0].c_str());
+        if (!m_mux) {
+            reply(at, echo + "\r\nERROR\r\n");
+        } else if (mode) {
+            m_server_port = args.size() > 1 ? atoi(args[1].c_str()) : 333;
+            reply(at, echo + "\r\nOK\r\n");
+        } else if (legacy) {
+            reply(at, echo + "we must restart\r\n");
+        } else {
+            m_server_port = 0;
+            reply(at, echo + "\r\nOK\r\n");
+        }
+    } else if (name == "AT+CIPSTO" && set) {
+        reply(at, echo + "\r\nOK\r\n");
+    } else {
+        reply(at, echo + "\r\nERROR\r\n");
+    }
+}
@@ -0,0 +1,169 @@
+/**
+ * @file ESP8266Sim.h
+ * @brief Scripted ESP8266 AT firmware emulator for host builds.
+ *
+ * The emulator sits at the far end of a simulated HardwareSerial. It echoes
+ * and answers the AT command set used by WeeESP8266 with the framing of the
+ * AT firmware (echo, "\r\r\n", "OK"/"ERROR", "> " prompt, "SEND OK",
+ * "+IPD" frames) and models firmware turnaround, network round trip, DNS,
+ * AP join and reboot time on top of the baud-rate timing of the UART.
+ * AT+CIPMODE=1 passthrough is modelled with packing on silence and the
+ * "+++" escape with its guard times. AT+UART_CUR and AT+UART_DEF change
+ * the rate the emulator talks at, so a driver left at the old rate only
+ * sees garbage.
+ *
+ * @par Copyright:
+ * Copyright (c) 2026 WeeESP8266 contributors. \n\n
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ */
+#ifndef __ESP8266SIM_H__
+#define __ESP8266SIM_H__
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+
+#define ESP8266SIM_LINKS        (5)
+#define ESP8266SIM_SEND_MAX     (2048)
+
+/*
+ * Plays a server on a link: returns the reply to data sent by the driver
+ * and sets *close to have the server close the link after it.
+ */
+typedef std::string (*ESP8266SimResponder)(uint8_t mux_id, const std::string &data, bool *close, void *arg);
+
+struct ESP8266SimAP {
+    int ecn;
+    std::string ssid;
+    int rssi;
+    std::string mac;
+    int channel;
+};
+
+class ESP8266Sim : public SerialPeer {
+ public:
+    ESP8266Sim(HardwareSerial &uart);
+    
+    virtual void onByte(uint8_t c, uint64_t t);
+    virtual void onIdle(uint64_t now);
+    virtual unsigned long lineBaud(void) const { return m_baud; }
+    
+    /*
+     * Remote side of the links: the bench uses these to play the server.
+     */
+    void push(uint8_t mux_id, const uint8_t *data, size_t len, uint64_t delay_us = 0);
+    void accept(uint8_t mux_id, const char *ip, uint32_t port, uint64_t delay_us = 0);
+    void remoteClose(uint8_t mux_id, uint64_t delay_us = 0);
+    
+    /*
+     * Payload the driver has sent on a link since the last call.
+     */
+    std::string takeSent(uint8_t mux_id);
+    bool linkOpen(uint8_t mux_id) const { return mux_id < ESP8266SIM_LINKS && m_links[mux_id].open; }
+    bool passthrough(void) const { return m_passthrough; }
+    
+    /* Timing model (us). */
+    uint64_t cmd_latency_us;    /* firmware turnaround of a command */
+    uint64_t rtt_us;            /* network round trip */
+    uint64_t dns_us;            /* name lookup done by AT+CIPSTART or AT+CIPDOMAIN */
+    uint64_t join_us;           /* AT+CWJAP: scan, association and DHCP */
+    uint64_t join_scan_us;      /* the scan in join_us, skipped when given the BSSID */
+    uint64_t dhcp_us;           /* the DHCP in join_us, skipped with a static address */
+    uint64_t scan_us;           /* AT+CWLAP */
+    uint64_t boot_us;           /* AT+RST until "ready" */
+    uint64_t pack_us;           /* silence that ends a packet in passthrough */
+    uint64_t guard_us;          /* silence required around "+++" */
+    
+    /* Behaviour. */
+    bool echo_payload;          /* remote peers echo what they receive */
+    unsigned long max_baud;     /* above this the driver cannot read replies, 0 for no limit */
+    size_t sendbuf_segments;    /* packages AT+CIPSENDBUF holds before refusing more */
+    unsigned first_segment;     /* id AT+CIPSENDBUF gives the first package of a link */
+    bool sendbuf_fail;          /* buffered packages end with SEND FAIL */
+    bool banner;                /* "ready" printed after booting */
+    bool quote_domain;          /* +CIPDOMAIN:"a.b.c.d" rather than +CIPDOMAIN:a.b.c.d */
+    bool legacy;                /* 0.9.x firmware: no _CUR commands or AT+CIPDOMAIN, AT+CIPSERVER=0 wants a restart */
+    std::map<std::string, std::string> hosts; /* addresses of names, others get 93.184.216.34 ("bad..." none) */
+    std::set<std::string> down; /* addresses refusing connections */
+    std::vector<ESP8266SimAP> aps;
+    ESP8266SimResponder responder;  /* replaces the echo when set */
+    void *responder_arg;
+    
+    /* Counters. */
+    unsigned long commands;
+    unsigned long busy_replies;
+    unsigned long payload_in;   /* bytes received through AT+CIPSEND */
+    unsigned long payload_out;  /* bytes sent as +IPD */
+    unsigned long connects;     /* links opened by AT+CIPSTART */
+    unsigned long sendbuf_refused; /* AT+CIPSENDBUF with the buffer full */
+    unsigned long lookups;      /* names looked up by AT+CIPSTART or AT+CIPDOMAIN */
+    
+ private:
+    struct Link {
+        bool open;
+        bool server;
+        std::string type;
+        std::string ip;
+        uint32_t port;
+        uint32_t local_port;
+        std::string sent;
+        unsigned seg_next;      /* segment id of the next AT+CIPSENDBUF */
+        std::vector<uint64_t> unacked; /* when each buffered segment gets its SEND OK */
+    };
+    
+    void reply(uint64_t t, const std::string &s);
+    void pushAt(uint8_t mux_id, const uint8_t *data, size_t len, uint64_t at);
+    void closeAt(uint8_t mux_id, uint64_t at);
+    void later(uint64_t at, const std::string &s);
+    void execute(const std::string &line, uint64_t t);
+    void finishSend(uint64_t t);
+    void reboot(uint64_t t);
+    bool passthroughByte(uint8_t c, uint64_t t);
+    void passthroughFlush(uint64_t t);
+    std::string lapFields(const ESP8266SimAP &ap) const;
+    static bool strongerAP(const ESP8266SimAP &a, const ESP8266SimAP &b);
+    static std::vector<std::string> splitArgs(const std::string &s);
+    static bool isNumericIP(const std::string &host);
+    std::string resolve(const std::string &host);
+    
+    HardwareSerial *m_uart;
+    unsigned long m_baud;       /* set by AT+UART_CUR, 0 until then */
+    unsigned long m_boot_baud;  /* set by AT+UART_DEF, 0 until then */
+    std::string m_line;
+    uint64_t m_ready_at;
+    uint64_t m_busy_until;
+    
+    int m_mux;
+    int m_cwmode;
+    bool m_lap_sort;            /* AT+CWLAPOPT */
+    int m_lap_mask;
+    bool m_joined;
+    std::string m_ssid;
+    size_t m_ap;                /* index in aps of the AP joined */
+    std::string m_static_ip;    /* set by AT+CIPSTA_CUR, empty with DHCP */
+    int m_server_port;
+    uint32_t m_next_local_port;
+    Link m_links[ESP8266SIM_LINKS];
+    
+    int m_cipmode;
+    bool m_passthrough;
+    std::string m_pt_buf;       /* passthrough bytes not packed yet */
+    uint64_t m_pt_last;         /* arrival of the last passthrough byte */
+    uint64_t m_pt_silence;      /* silence before m_pt_buf began */
+    
+    int m_send_id;
+    size_t m_send_remaining;
+    std::string m_send_buf;
+    bool m_send_buffered;       /* AT+CIPSENDBUF rather than AT+CIPSEND */
+    
+    /* Replies sent when their time comes, not queued on the line before it. */
+    std::multimap<uint64_t, std::string> m_later;
+};
+
+#endif /* #ifndef __ESP8266SIM_H__ */
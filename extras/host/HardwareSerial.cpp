@@ -0,0 +1,208 @@
+/**
+ * @file HardwareSerial.cpp
+ * @brief Host UART model with baud-rate timing.
+ *
+ * @par Copyright:
+ * Copyright (c) 2026 WeeESP8266 contributors. \n\n
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ */
+#include <stdio.h>
+
+#include "Arduino.h"
+
+HardwareSerial Serial;
+HardwareSerial Serial1;
+HardwareSerial Serial2;
+HardwareSerial Serial3;
+
+HardwareSerial *HardwareSerial::s_all = NULL;
+uint64_t HardwareSerial::poll_quantum_us = 10;
+
+/* Nothing is in flight: skip ahead in bigger steps until a timeout fires. */
+#define IDLE_QUANTUM_US     (1000)
+
+HardwareSerial::HardwareSerial(void)
+    : m_rx_size(SERIAL_RX_BUFFER_SIZE), m_rx_line_free(0), m_tx_line_free(0),
+      m_baud(9600), m_rx_overflows(0), m_tx_bytes(0), m_rx_bytes(0),
+      m_idle_polls(0), m_peer(NULL), m_next(s_all)
+{
+    s_all = this;
+}
+
+HardwareSerial::~HardwareSerial()
+{
+    HardwareSerial **pp = &s_all;
+    while (*pp) {
+        if (*pp == this) {
+            *pp = m_next;
+            break;
+        }
+        pp = &(*pp)->m_next;
+    }
+}
+
+void HardwareSerial::begin(unsigned long baud)
+{
+    m_baud = baud ? baud : 9600;
+}
+
+void HardwareSerial::end(void)
+{
+}
+
+void HardwareSerial::attach(SerialPeer *peer)
+{
+    m_peer = peer;
+}
+
+uint64_t HardwareSerial::byteTime(void) const
+{
+    return frameTime(m_baud);
+}
+
+uint64_t HardwareSerial::frameTime(unsigned long baud)
+{
+    return (10ULL * 1000000ULL + baud - 1) / baud;
+}
+
+bool HardwareSerial::mismatched(void) const
+{
+    return m_peer && m_peer->lineBaud() && m_peer->lineBaud() != m_baud;
+}
+
+/* What a byte sent at the wrong rate looks like: never plain ASCII. */
+static uint8_t garble(uint8_t c)
+{
+    return (uint8_t)(c * 37 + 11) | 0x80;
+}
+
+void HardwareSerial::resetCounters(void)
+{
+    m_rx_overflows = 0;
+    m_tx_bytes = 0;
+    m_rx_bytes = 0;
+    m_idle_polls = 0;
+}
+
+void HardwareSerial::deliver(const uint8_t *data, size_t len, uint64_t at)
+{
+    uint64_t t = at > m_rx_line_free ? at : m_rx_line_free;
+    unsigned long rate = m_peer && m_peer->lineBaud() ? m_peer->lineBaud() : m_baud;
+    uint64_t bt = frameTime(rate);
+    bool bad = mismatched();
+    for (size_t i = 0; i < len; i++) {
+        t += bt;
+        Timed b = { t, bad ? garble(data[i]) : data[i] };
+        m_wire_rx.push_back(b);
+    }
+    m_rx_line_free = t;
+}
+
+void HardwareSerial::service(void)
+{
+    uint64_t now = sim_now_us();
+    bool progress = true;
+    while (progress) {
+        progress = false;
+        while (!m_wire_tx.empty() && m_wire_tx.front().t <= now) {
+            Timed b = m_wire_tx.front();
+            m_wire_tx.pop_front();
+            if (m_peer) {
+                m_peer->onByte(mismatched() ? garble(b.c) : b.c, b.t);
+            }
+            progress = true;
+        }
+        while (!m_wire_rx.empty() && m_wire_rx.front().t <= now) {
+            if (m_rx.size() < m_rx_size) {
+                m_rx.push_back(m_wire_rx.front().c);
+            } else {
+                m_rx_overflows++;
+            }
+            m_wire_rx.pop_front();
+            progress = true;
+        }
+    }
+    if (m_peer) {
+        m_peer->onIdle(now);
+    }
+}
+
+void HardwareSerial::serviceAll(void)
+{
+    for (HardwareSerial *p = s_all; p; p = p->m_next) {
+        p->service();
+    }
+}
+
+int HardwareSerial::available(void)
+{
+    service();
+    if (m_rx.empty()) {
+        m_idle_polls++;
+        if (m_wire_rx.empty() && m_wire_tx.empty()) {
+            sim_advance_us(IDLE_QUANTUM_US);
+        } else {
+            sim_advance_us(poll_quantum_us);
+        }
+        service();
+    }
+    return (int)m_rx.size();
+}
+
+int HardwareSerial::read(void)
+{
+    service();
+    if (m_rx.empty()) {
+        return -1;
+    }
+    uint8_t c = m_rx.front();
+    m_rx.pop_front();
+    m_rx_bytes++;
+    return c;
+}
+
+int HardwareSerial::peek(void)
+{
+    service();
+    if (m_rx.empty()) {
+        return -1;
+    }
+    return m_rx.front();
+}
+
+void HardwareSerial::flush(void)
+{
+    sim_set_now_us(m_tx_line_free);
+    service();
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    return write(&c, 1);
+}
+
+size_t HardwareSerial::write(const uint8_t *buffer, size_t size)
+{
+    if (!m_peer) {
+        fwrite(buffer, 1, size, stdout);
+        return size;
+    }
+    uint64_t bt = byteTime();
+    for (size_t i = 0; i < size; i++) {
+        uint64_t now = sim_now_us();
+        uint64_t start = m_tx_line_free > now ? m_tx_line_free : now;
+        /* A full TX buffer blocks the caller, as in the AVR core. */
+        if (start > now + SERIAL_TX_BUFFER_SIZE * bt) {
+            sim_set_now_us(start - SERIAL_TX_BUFFER_SIZE * bt);
+        }
+        m_tx_line_free = start + bt;
+        Timed b = { m_tx_line_free, buffer[i] };
+        m_wire_tx.push_back(b);
+    }
+    m_tx_bytes += size;
+    service();
+    return size;
+}
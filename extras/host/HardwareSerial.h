@@ -0,0 +1,122 @@
+/**
+ * @file HardwareSerial.h
+ * @brief Host UART model with baud-rate timing.
+ *
+ * Each instance models one UART wired to a SerialPeer (the AT firmware
+ * emulator). Bytes travel at the configured baud rate with 10 bits per
+ * frame, land in a receive buffer of limited size (64 bytes by default,
+ * like the AVR core) and are lost when that buffer is full. A peer at a
+ * different baud rate sees garbage and is seen as garbage. An instance
+ * without a peer writes to stdout, which is how Serial behaves on host.
+ *
+ * @par Copyright:
+ * Copyright (c) 2026 WeeESP8266 contributors. \n\n
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ */
+#ifndef __HOST_HARDWARESERIAL_H__
+#define __HOST_HARDWARESERIAL_H__
+
+#include <deque>
+
+#include "Stream.h"
+
+#define SERIAL_RX_BUFFER_SIZE   64
+#define SERIAL_TX_BUFFER_SIZE   64
+
+/*
+ * The far end of a simulated UART.
+ */
+class SerialPeer {
+ public:
+    virtual ~SerialPeer() {}
+    
+    /*
+     * A byte written by the driver has arrived at time t (us).
+     */
+    virtual void onByte(uint8_t c, uint64_t t) = 0;
+    
+    /*
+     * Called whenever the UART is serviced, for behaviour driven by silence on the line.
+     */
+    virtual void onIdle(uint64_t now) {}
+    
+    /*
+     * The baud rate the peer talks at, 0 for whatever the UART is set to.
+     * Bytes cross a mismatched line garbled.
+     */
+    virtual unsigned long lineBaud(void) const { return 0; }
+};
+
+class HardwareSerial : public Stream {
+ public:
+    HardwareSerial(void);
+    virtual ~HardwareSerial();
+
+    void begin(unsigned long baud);
+    void end(void);
+    virtual int available(void);
+    virtual int read(void);
+    virtual int peek(void);
+    virtual void flush(void);
+    virtual size_t write(uint8_t c);
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    using Print::write;
+    operator bool() { return true; }
+
+    /*
+     * Host-only interface used by the simulator and the benchmark.
+     */
+    void attach(SerialPeer *peer);
+    void deliver(const uint8_t *data, size_t len, uint64_t at);
+    void setRxBufferSize(size_t size) { m_rx_size = size; }
+    unsigned long baud(void) const { return m_baud; }
+    uint64_t byteTime(void) const;
+    unsigned long rxOverflows(void) const { return m_rx_overflows; }
+    unsigned long txBytes(void) const { return m_tx_bytes; }
+    unsigned long rxBytes(void) const { return m_rx_bytes; }
+    unsigned long idlePolls(void) const { return m_idle_polls; }
+    void resetCounters(void);
+    void service(void);
+    static void serviceAll(void);
+    
+    /*
+     * Virtual time an empty poll of available() costs (us). It stands for
+     * one pass of the driver's busy-wait loop.
+     */
+    static uint64_t poll_quantum_us;
+
+ private:
+    struct Timed {
+        uint64_t t;
+        uint8_t c;
+    };
+    
+    static uint64_t frameTime(unsigned long baud);
+    bool mismatched(void) const;
+    
+    std::deque<Timed> m_wire_rx;    /* on the wire towards the driver */
+    std::deque<Timed> m_wire_tx;    /* on the wire towards the peer */
+    std::deque<uint8_t> m_rx;       /* arrived, waiting in the RX buffer */
+    size_t m_rx_size;
+    uint64_t m_rx_line_free;
+    uint64_t m_tx_line_free;
+    unsigned long m_baud;
+    unsigned long m_rx_overflows;
+    unsigned long m_tx_bytes;
+    unsigned long m_rx_bytes;
+    unsigned long m_idle_polls;
+    SerialPeer *m_peer;
+    HardwareSerial *m_next;
+    
+    static HardwareSerial *s_all;
+};
+
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+extern HardwareSerial Serial3;
+
+#endif /* #ifndef __HOST_HARDWARESERIAL_H__ */
@@ -0,0 +1,135 @@
+/**
+ * @file Print.cpp
+ * @brief Host implementation of the Arduino Print class.
+ *
+ * @par Copyright:
+ * Copyright (c) 2026 WeeESP8266 contributors. \n\n
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ */
+#include <string.h>
+
+#include "Print.h"
+
+size_t Print::write(const uint8_t *buffer, size_t size)
+{
+    size_t n = 0;
+    while (size--) {
+        n += write(*buffer++);
+    }
+    return n;
+}
+
+size_t Print::write(const char *str)
+{
+    if (str == NULL) {
+        return 0;
+    }
+    return write((const uint8_t *)str, strlen(str));
+}
+
+size_t Print::print(const __FlashStringHelper *ifsh)
+{
+    return write((const char *)ifsh);
+}
+
+size_t Print::print(const String &s)
+{
+    return write((const uint8_t *)s.c_str(), s.length());
+}
+
+size_t Print::print(const char str[])
+{
+    return write(str);
+}
+
+size_t Print::print(char c)
+{
+    return write((uint8_t)c);
+}
+
+size_t Print::print(unsigned char n, int base)
+{
+    return print(String(n, (unsigned char)base));
+}
+
+size_t Print::print(int n, int base)
+{
+    return print(String(n, (unsigned char)base));
+}
+
+size_t Print::print(unsigned int n, int base)
+{
+    return print(String(n, (unsigned char)base));
+}
+
+size_t Print::print(long n, int base)
+{
+    return print(String(n, (unsigned char)base));
+}
+
+size_t Print::print(unsigned long n, int base)
+{
+    return print(String(n, (unsigned char)base));
+}
+
+size_t Print::println(void)
+{
+    return write("\r\n");
+}
+
+size_t Print::println(const __FlashStringHelper *ifsh)
+{
+    size_t n = print(ifsh);
+    return n + println();
+}
+
+size_t Print::println(const String &s)
+{
+    size_t n = print(s);
+    return n + println();
+}
+
+size_t Print::println(const char str[])
+{
+    size_t n = print(str);
+    return n + println();
+}
+
+size_t Print::println(char c)
+{
+    size_t n = print(c);
+    return n + println();
+}
+
+size_t Print::println(unsigned char num, int base)
+{
+    size_t n = print(num, base);
+    return n + println();
+}
+
+size_t Print::println(int num, int base)
+{
+    size_t n = print(num, base);
+    return n + println();
+}
+
+size_t Print::println(unsigned int num, int base)
+{
+    size_t n = print(num, base);
+    return n + println();
+}
+
+size_t Print::println(long num, int base)
+{
+    size_t n = print(num, base);
+    return n + println();
+}
+
+size_t Print::println(unsigned long num, int base)
+{
+    size_t n = print(num, base);
+    return n + println();
+}
@@ -0,0 +1,51 @@
+/**
+ * @file Print.h
+ * @brief Host implementation of the Arduino Print class.
+ *
+ * @par Copyright:
+ * Copyright (c) 2026 WeeESP8266 contributors. \n\n
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ */
+#ifndef __HOST_PRINT_H__
+#define __HOST_PRINT_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include "WString.h"
+
+class Print {
+ public:
+    virtual ~Print() {}
+
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t *buffer, size_t size);
+    size_t write(const char *str);
+    size_t write(const char *buffer, size_t size) { return write((const uint8_t *)buffer, size); }
+
+    size_t print(const __FlashStringHelper *ifsh);
+    size_t print(const String &s);
+    size_t print(const char str[]);
+    size_t print(char c);
+    size_t print(unsigned char n, int base = 10);
+    size_t print(int n, int base = 10);
+    size_t print(unsigned int n, int base = 10);
+    size_t print(long n, int base = 10);
+    size_t print(unsigned long n, int base = 10);
+
+    size_t println(const __FlashStringHelper *ifsh);
+    size_t println(const String &s);
+    size_t println(const char str[]);
+    size_t println(char c);
+    size_t println(unsigned char n, int base = 10);
+    size_t println(int n, int base = 10);
+    size_t println(unsigned int n, int base = 10);
+    size_t println(long n, int base = 10);
+    size_t println(unsigned long n, int base = 10);
+    size_t println(void);
+};
+
+#endif /* #ifndef __HOST_PRINT_H__ */
@@ -0,0 +1,25 @@
+/**
+ * @file Stream.h
+ * @brief Host implementation of the Arduino Stream class.
+ *
+ * @par Copyright:
+ * Copyright (c) 2026 WeeESP8266 contributors. \n\n
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ */
+#ifndef __HOST_STREAM_H__
+#define __HOST_STREAM_H__
+
+#include "Print.h"
+
+class Stream : public Print {
+ public:
+    virtual int available(void) = 0;
+    virtual int read(void) = 0;
+    virtual int peek(void) = 0;
+    virtual void flush(void) = 0;
+};
+
+#endif /* #ifndef __HOST_STREAM_H__ */
@@ -0,0 +1,279 @@
+/**
+ * @file WString.cpp
+ * @brief Host implementation of the Arduino String class.
+ *
+ * @par Copyright:
+ * Copyright (c) 2026 WeeESP8266 contributors. \n\n
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "WString.h"
+
+static std::string toBase(unsigned long value, unsigned char base)
+{
+    char buf[sizeof(unsigned long) * 8 + 1];
+    int i = sizeof(buf) - 1;
+    buf[i] = '\0';
+    if (base < 2) {
+        base = 10;
+    }
+    do {
+        unsigned long digit = value % base;
+        buf[--i] = (char)(digit < 10 ? '0' + digit : 'A' + digit - 10);
+        value /= base;
+    } while (value);
+    return std::string(&buf[i]);
+}
+
+static std::string toBaseSigned(long value, unsigned char base)
+{
+    if (value < 0 && base == 10) {
+        return "-" + toBase((unsigned long)(-value), base);
+    }
+    return toBase((unsigned long)value, base);
+}
+
+String::String(const char *cstr): m_str(cstr ? cstr : "")
+{
+}
+
+String::String(const String &str): m_str(str.m_str)
+{
+}
+
+String::String(const __FlashStringHelper *str): m_str(str ? (const char *)str : "")
+{
+}
+
+String::String(char c): m_str(1, c)
+{
+}
+
+String::String(unsigned char value, unsigned char base): m_str(toBase(value, base))
+{
+}
+
+String::String(int value, unsigned char base): m_str(toBaseSigned(value, base))
+{
+}
+
+String::String(unsigned int value, unsigned char base): m_str(toBase(value, base))
+{
+}
+
+String::String(long value, unsigned char base): m_str(toBaseSigned(value, base))
+{
+}
+
+String::String(unsigned long value, unsigned char base): m_str(toBase(value, base))
+{
+}
+
+String &String::operator =(const String &rhs)
+{
+    m_str = rhs.m_str;
+    return *this;
+}
+
+String &String::operator =(const char *cstr)
+{
+    m_str = cstr ? cstr : "";
+    return *this;
+}
+
+unsigned char String::reserve(unsigned int size)
+{
+    m_str.reserve(size);
+    return 1;
+}
+
+unsigned char String::concat(const String &str)
+{
+    m_str += str.m_str;
+    return 1;
+}
+
+unsigned char String::concat(const char *cstr)
+{
+    if (!cstr) {
+        return 0;
+    }
+    m_str += cstr;
+    return 1;
+}
+
+unsigned char String::concat(char c)
+{
+    m_str += c;
+    return 1;
+}
+
+unsigned char String::concat(int num)
+{
+    m_str += toBaseSigned(num, 10);
+    return 1;
+}
+
+unsigned char String::concat(unsigned int num)
+{
+    m_str += toBase(num, 10);
+    return 1;
+}
+
+unsigned char String::concat(long num)
+{
+    m_str += toBaseSigned(num, 10);
+    return 1;
+}
+
+unsigned char String::concat(unsigned long num)
+{
+    m_str += toBase(num, 10);
+    return 1;
+}
+
+String operator +(const String &lhs, const String &rhs)
+{
+    String s(lhs);
+    s.concat(rhs);
+    return s;
+}
+
+String operator +(const String &lhs, const char *cstr)
+{
+    String s(lhs);
+    s.concat(cstr);
+    return s;
+}
+
+String operator +(const String &lhs, char c)
+{
+    String s(lhs);
+    s.concat(c);
+    return s;
+}
+
+unsigned char String::equals(const char *cstr) const
+{
+    return m_str == (cstr ? cstr : "");
+}
+
+unsigned char String::startsWith(const String &prefix) const
+{
+    return m_str.compare(0, prefix.m_str.size(), prefix.m_str) == 0;
+}
+
+unsigned char String::endsWith(const String &suffix) const
+{
+    if (suffix.m_str.size() > m_str.size()) {
+        return 0;
+    }
+    return m_str.compare(m_str.size() - suffix.m_str.size(), suffix.m_str.size(), suffix.m_str) == 0;
+}
+
+char String::charAt(unsigned int index) const
+{
+    return index < m_str.size() ? m_str[index] : '\0';
+}
+
+void String::setCharAt(unsigned int index, char c)
+{
+    if (index < m_str.size()) {
+        m_str[index] = c;
+    }
+}
+
+int String::indexOf(char ch, unsigned int from) const
+{
+    size_t pos = m_str.find(ch, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::indexOf(const String &str, unsigned int from) const
+{
+    if (from >= m_str.size()) {
+        return -1;
+    }
+    size_t pos = m_str.find(str.m_str, from);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(char ch) const
+{
+    size_t pos = m_str.rfind(ch);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+int String::lastIndexOf(const String &str) const
+{
+    size_t pos = m_str.rfind(str.m_str);
+    return pos == std::string::npos ? -1 : (int)pos;
+}
+
+String String::substring(unsigned int begin, unsigned int end) const
+{
+    if (begin > end) {
+        unsigned int tmp = begin;
+        begin = end;
+        end = tmp;
+    }
+    if (begin >= m_str.size()) {
+        return String("");
+    }
+    if (end > m_str.size()) {
+        end = m_str.size();
+    }
+    return String(m_str.substr(begin, end - begin).c_str());
+}
+
+void String::remove(unsigned int index)
+{
+    if (index < m_str.size()) {
+        m_str.erase(index);
+    }
+}
+
+void String::remove(unsigned int index, unsigned int count)
+{
+    if (index < m_str.size()) {
+        m_str.erase(index, count);
+    }
+}
+
+void String::trim(void)
+{
+    size_t b = 0;
+    size_t e = m_str.size();
+    while (b < e && isspace((unsigned char)m_str[b])) {
+        b++;
+    }
+    while (e > b && isspace((unsigned char)m_str[e - 1])) {
+        e--;
+    }
+    m_str = m_str.substr(b, e - b);
+}
+
+long String::toInt(void) const
+{
+    return atol(m_str.c_str());
+}
+
+void String::toCharArray(char *buf, unsigned int bufsize, unsigned int index) const
+{
+    if (bufsize == 0 || buf == NULL) {
+        return;
+    }
+    if (index >= m_str.size()) {
+        buf[0] = '\0';
+        return;
+    }
+    size_t n = m_str.copy(buf, bufsize - 1, index);
+    buf[n] = '\0';
+}
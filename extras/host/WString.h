@@ -0,0 +1,92 @@
+/**
+ * @file WString.h
+ * @brief Host implementation of the Arduino String class.
+ *
+ * @par Copyright:
+ * Copyright (c) 2026 WeeESP8266 contributors. \n\n
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ */
+#ifndef __HOST_WSTRING_H__
+#define __HOST_WSTRING_H__
+
+#include <stdint.h>
+#include <string>
+
+class __FlashStringHelper;
+
+class String {
+ public:
+    String(const char *cstr = "");
+    String(const String &str);
+    String(const __FlashStringHelper *str);
+    explicit String(char c);
+    explicit String(unsigned char value, unsigned char base = 10);
+    explicit String(int value, unsigned char base = 10);
+    explicit String(unsigned int value, unsigned char base = 10);
+    explicit String(long value, unsigned char base = 10);
+    explicit String(unsigned long value, unsigned char base = 10);
+
+    String &operator =(const String &rhs);
+    String &operator =(const char *cstr);
+
+    unsigned int length(void) const { return (unsigned int)m_str.size(); }
+    const char *c_str(void) const { return m_str.c_str(); }
+    unsigned char reserve(unsigned int size);
+
+    unsigned char concat(const String &str);
+    unsigned char concat(const char *cstr);
+    unsigned char concat(char c);
+    unsigned char concat(int num);
+    unsigned char concat(unsigned int num);
+    unsigned char concat(long num);
+    unsigned char concat(unsigned long num);
+
+    String &operator +=(const String &rhs) { concat(rhs); return *this; }
+    String &operator +=(const char *cstr) { concat(cstr); return *this; }
+    String &operator +=(char c) { concat(c); return *this; }
+    String &operator +=(int num) { concat(num); return *this; }
+    String &operator +=(unsigned int num) { concat(num); return *this; }
+    String &operator +=(long num) { concat(num); return *this; }
+    String &operator +=(unsigned long num) { concat(num); return *this; }
+
+    friend String operator +(const String &lhs, const String &rhs);
+    friend String operator +(const String &lhs, const char *cstr);
+    friend String operator +(const String &lhs, char c);
+
+    unsigned char equals(const String &s) const { return m_str == s.m_str; }
+    unsigned char equals(const char *cstr) const;
+    unsigned char operator ==(const String &rhs) const { return equals(rhs); }
+    unsigned char operator ==(const char *cstr) const { return equals(cstr); }
+    unsigned char operator !=(const String &rhs) const { return !equals(rhs); }
+    unsigned char operator !=(const char *cstr) const { return !equals(cstr); }
+    unsigned char startsWith(const String &prefix) const;
+    unsigned char endsWith(const String &suffix) const;
+
+    char charAt(unsigned int index) const;
+    void setCharAt(unsigned int index, char c);
+    char operator [](unsigned int index) const { return charAt(index); }
+
+    int indexOf(char ch) const { return indexOf(ch, 0); }
+    int indexOf(char ch, unsigned int from) const;
+    int indexOf(const String &str) const { return indexOf(str, 0); }
+    int indexOf(const String &str, unsigned int from) const;
+    int lastIndexOf(char ch) const;
+    int lastIndexOf(const String &str) const;
+
+    String substring(unsigned int begin) const { return substring(begin, length()); }
+    String substring(unsigned int begin, unsigned int end) const;
+
+    void remove(unsigned int index);
+    void remove(unsigned int index, unsigned int count);
+    void trim(void);
+    long toInt(void) const;
+    void toCharArray(char *buf, unsigned int bufsize, unsigned int index = 0) const;
+
+ private:
+    std::string m_str;
+};
+
+#endif /* #ifndef __HOST_WSTRING_H__ */
@@ -0,0 +1,1538 @@
+/**
+ * @file bench.cpp
+ * @brief Throughput and latency benchmark of WeeESP8266 against the emulator.
+ *
+ * Every figure has two clocks: "virt" is simulated time (UART baud rate,
+ * firmware turnaround and network RTT as modelled by ESP8266Sim) and "cpu"
+ * is host CPU time spent in the driver plus the simulator. Compare runs of
+ * the same build options only.
+ *
+ * Usage: bench [-b baud]... [-n iterations]
+ *
+ * @par Copyright:
+ * Copyright (c) 2026 WeeESP8266 contributors. \n\n
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+#include "CommandNames.h"
+#include "ESP8266.h"
+#include "ESP8266HTTP.h"
+#include "ESP8266Pool.h"
+#include "ESP8266Sim.h"
+
+#define SSID        "ITEAD"
+#define PASSWORD    "12345678"
+#define HOST_IP     "172.16.5.12"
+#define HOST_PORT   (8090)
+
+static unsigned long g_failures = 0;
+
+static double cpu_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+/*
+ * One simulated module wired to one driver instance.
+ */
+struct Rig {
+    HardwareSerial uart;
+    ESP8266Sim sim;
+    ESP8266 wifi;
+    
+    Rig(uint32_t baud): sim(uart), wifi(uart, baud) {}
+};
+
+/*
+ * Times a batch of calls on both clocks.
+ */
+class Measure {
+ public:
+    Measure(const char *name): m_name(name), m_calls(0), m_bytes(0), m_fail(0)
+    {
+        m_virt0 = sim_now_us();
+        m_cpu0 = cpu_us();
+    }
+    
+    void call(bool ok, unsigned long bytes = 0)
+    {
+        m_calls++;
+        m_bytes += bytes;
+        if (!ok) {
+            m_fail++;
+        }
+    }
+    
+    void report(void)
+    {
+        double virt = (double)(sim_now_us() - m_virt0);
+        double cpu = cpu_us() - m_cpu0;
+        unsigned long n = m_calls ? m_calls : 1;
+        printf("%-24s %6lu %11.3f %10.1f %10.2f %11.2f %5lu\n", m_name, m_calls,
+            virt / n / 1000.0, virt > 0 ? m_calls * 1e6 / virt : 0.0,
+            virt > 0 ? m_bytes * 1e6 / virt / 1024.0 : 0.0, cpu / n, m_fail);
+        g_failures += m_fail;
+    }
+    
+ private:
+    const char *m_name;
+    unsigned long m_calls;
+    unsigned long m_bytes;
+    unsigned long m_fail;
+    uint64_t m_virt0;
+    double m_cpu0;
+};
+
+static void fill(uint8_t *buf, uint32_t len, uint32_t seed)
+{
+    for (uint32_t i = 0; i < len; i++) {
+        buf[i] = (uint8_t)('a' + (seed + i) % 26);
+    }
+}
+
+/* State shared with the callbacks of the poll() test */
+struct PollState {
+    uint8_t in[256];
+    uint32_t got;
+    bool done;
+    bool ok;
+};
+
+static void onData(uint8_t mux_id, const uint8_t *data, uint32_t len, void *arg)
+{
+    PollState *st = (PollState *)arg;
+    if (st->got + len <= sizeof(st->in)) {
+        memcpy(st->in + st->got, data, len);
+    }
+    st->got += len;
+}
+
+static void onCommand(uint8_t command, bool success, void *arg)
+{
+    PollState *st = (PollState *)arg;
+    st->done = true;
+    st->ok = success;
+}
+
+/* Generates the same bytes as fill() without a buffer */
+struct FillSource {
+    uint32_t seed;
+    uint32_t pos;
+};
+
+static uint32_t onSource(uint8_t *buffer, uint32_t len, void *arg)
+{
+    FillSource *src = (FillSource *)arg;
+    fill(buffer, len, src->seed + src->pos);
+    src->pos += len;
+    return len;
+}
+
+/* Collected by the scanAP() test */
+struct ScanState {
+    ESP8266AP first;
+    ESP8266AP last;
+    unsigned long count;
+};
+
+static void onAP(const ESP8266AP *ap, void *arg)
+{
+    ScanState *st = (ScanState *)arg;
+    if (st->count++ == 0) {
+        st->first = *ap;
+    }
+    st->last = *ap;
+}
+
+static bool firstAP(const ScanState &st, const char *ssid, int ecn, int rssi, int channel, bool mac)
+{
+    static const uint8_t itead[6] = { 0xc8, 0x3a, 0x35, 0x01, 0x02, 0x03 };
+    return !strcmp(st.first.ssid, ssid) && st.first.ecn == ecn && st.first.rssi == rssi
+        && st.first.channel == channel && (!mac || !memcmp(st.first.mac, itead, 6));
+}
+
+/*
+ * Plays an HTTP/1.1 server: "/len/<n>" answers n bytes of fill() with
+ * Content-Length, "/chunked/<n>" the same in chunks of at most 100 bytes.
+ * Keeps the connection unless the request asks to close it.
+ */
+static std::string onHTTP(uint8_t mux_id, const std::string &request, bool *close, void *arg)
+{
+    uint8_t body[4096];
+    char head[64];
+    std::string out;
+    size_t path = request.find(' ') + 1;
+    bool chunked = request.compare(path, 9, "/chunked/") == 0;
+    uint32_t len = strtoul(request.c_str() + path + (chunked ? 9 : 5), NULL, 10);
+    
+    if (len > sizeof(body)) {
+        len = sizeof(body);
+    }
+    fill(body, len, len);
+    *close = request.find("Connection: close\r\n") != std::string::npos;
+    if (chunked) {
+        out = "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+        for (uint32_t i = 0; i < len; i += 100) {
+            uint32_t n = len - i < 100 ? len - i : 100;
+            snprintf(head, sizeof(head), "%x;x=y\r\n", (unsigned)n);
+            out += head;
+            out.append((const char *)body + i, n);
+            out += "\r\n";
+        }
+        out += "0\r\n\r\n";
+    } else {
+        snprintf(head, sizeof(head), "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n\r\n", (unsigned)len);
+        out = head;
+        out.append((const char *)body, len);
+    }
+    return out;
+}
+
+static void onBody(const uint8_t *data, uint32_t len, void *arg)
+{
+    ((std::string *)arg)->append((const char *)data, len);
+}
+
+static bool checkBody(const std::string &got, uint32_t len)
+{
+    uint8_t body[4096];
+    fill(body, len, len);
+    return got.size() == len && memcmp(got.data(), body, len) == 0;
+}
+
+#ifdef ESP8266_USE_STATS
+static void printStats(ESP8266 &wifi)
+{
+    ESP8266Stats st;
+    wifi.getStats(&st);
+    printf("\n%-10s %6s %6s %8s   latency <2 <8 <32 <128 <512 <2048 <8192 more (ms)\n",
+        "command", "count", "errors", "timeouts");
+    for (int i = 1; i < ESP8266_CMD_COUNT; i++) {
+        const ESP8266CommandStats &c = st.command[i];
+        if (c.count == 0) {
+            continue;
+        }
+        printf("%-10s %6u %6u %8u  ", commandName(i), c.count, c.errors, c.timeouts);
+        for (int b = 0; b < ESP8266_STATS_BUCKETS; b++) {
+            printf(" %u", c.latency[b]);
+        }
+        printf("\n");
+    }
+    for (int i = 0; i < 5; i++) {
+        if (st.sent[i] || st.received[i]) {
+            printf("mux %d: sent %lu B, received %lu B\n", i,
+                (unsigned long)st.sent[i], (unsigned long)st.received[i]);
+        }
+    }
+    printf("dropped %lu B, rx buffer full %u times\n", (unsigned long)st.dropped, st.rx_full);
+}
+#endif
+
+static void run(uint32_t baud, int n)
+{
+    Rig rig(baud);
+    ESP8266 &wifi = rig.wifi;
+    ESP8266Sim &sim = rig.sim;
+    uint8_t out[8192];
+    uint8_t in[2048];
+    
+    printf("\n== baud %lu, rtt %.1f ms, firmware turnaround %.1f ms ==\n",
+        (unsigned long)baud, sim.rtt_us / 1000.0, sim.cmd_latency_us / 1000.0);
+    printf("%-24s %6s %11s %10s %10s %11s %5s\n",
+        "test", "calls", "virt ms/op", "ops/s", "KB/s", "cpu us/op", "fail");
+    
+    if (!wifi.kick() || !wifi.joinAP(SSID, PASSWORD) || !wifi.enableMUX()) {
+        printf("setup failed\n");
+        g_failures++;
+        return;
+    }
+    
+    {
+        Measure m("kick");
+        for (int i = 0; i < n; i++) {
+            m.call(wifi.kick());
+        }
+        m.report();
+    }
+    
+    {
+        Measure m("getVersion");
+        for (int i = 0; i < n; i++) {
+            m.call(wifi.getVersion() == "0018000902");
+        }
+        m.report();
+    }
+    
+    {
+        Measure m("getLocalIP");
+        for (int i = 0; i < n; i++) {
+            m.call(wifi.getLocalIP().indexOf("192.168.1.100") != -1);
+        }
+        m.report();
+    }
+    
+    {
+        Measure m("getAPList");
+        for (int i = 0; i < n; i++) {
+            m.call(wifi.getAPList().indexOf("Printer-AP") != -1);
+        }
+        m.report();
+    }
+    
+    {
+        Measure m("scanAP");
+        for (int i = 0; i < n; i++) {
+            ScanState st = { };
+            bool ok = wifi.scanAP(onAP, &st);
+            m.call(ok && st.count == sim.aps.size() && firstAP(st, "ITEAD", 3, -45, 1, true));
+        }
+        m.report();
+    }
+    
+    {
+        Measure m("scanAP sorted, 3 fields");
+        bool ok = wifi.setAPListOption(true, 0x0E);
+        for (int i = 0; i < n; i++) {
+            ScanState st = { };
+            ok = wifi.scanAP(onAP, &st) && ok;
+            m.call(ok && st.count == sim.aps.size() && firstAP(st, "ITEAD", 0, -45, 0, true)
+                && !strcmp(st.last.ssid, "Warehouse") && st.last.rssi == -88);
+        }
+        m.call(wifi.setAPListOption(false));
+        m.report();
+    }
+    
+    {
+        Measure m("scanAP one SSID");
+        for (int i = 0; i < n; i++) {
+            ScanState st = { };
+            bool ok = wifi.scanAP(onAP, &st, "Lab-2.4G");
+            m.call(ok && st.count == 1 && firstAP(st, "Lab-2.4G", 3, -55, 1, false));
+        }
+        m.report();
+    }
+    
+    {
+        Measure m("createTCP+releaseTCP");
+        for (int i = 0; i < n; i++) {
+            bool ok = wifi.createTCP(1, HOST_IP, HOST_PORT);
+            ok = wifi.releaseTCP(1) && ok;
+            m.call(ok);
+        }
+        m.report();
+    }
+    
+    {
+        Measure m("getIPStatus");
+        bool ok = wifi.createTCP(1, HOST_IP, HOST_PORT);
+        for (int i = 0; i < n; i++) {
+            m.call(ok && wifi.getIPStatus().indexOf("+CIPSTATUS:1,\"TCP\",\"" HOST_IP "\"") != -1);
+        }
+        m.report();
+    }
+    
+    {
+        /* Only the first call asks ESP8266, the rest come from the table. */
+        Measure m("getLinkStatus");
+        static const uint8_t host[4] = { 172, 16, 5, 12 };
+        bool ok = wifi.releaseTCP(1) && wifi.createTCP(1, HOST_IP, HOST_PORT);
+        unsigned long commands = sim.commands;
+        for (int i = 0; i < n; i++) {
+            const ESP8266LinkStatus *link = wifi.getLinkStatus(1);
+            m.call(ok && link->open && link->known && !link->server && !strcmp(link->type, "TCP")
+                && !memcmp(link->ip, host, 4) && link->remote_port == HOST_PORT && link->local_port != 0);
+        }
+        m.call(sim.commands - commands == 1);
+        m.report();
+    }
+    
+    {
+        Measure m("getLinkStatus accepted");
+        static const uint8_t client[4] = { 172, 16, 5, 20 };
+        bool ok = wifi.releaseTCP(1) && wifi.startTCPServer(333);
+        for (int i = 0; i < n; i++) {
+            sim.accept(3, "172.16.5.20", 50000 + i);
+            while (!wifi.getLinkStatus(3)->open) {
+                wifi.poll();
+            }
+            const ESP8266LinkStatus *link = wifi.getLinkStatus(3);
+            bool got = ok && link->known && link->server && !memcmp(link->ip, client, 4)
+                && link->remote_port == 50000 + i && link->local_port == 333;
+            sim.remoteClose(3);
+            while (wifi.getLinkStatus(3)->open) {
+                wifi.poll();
+            }
+            m.call(got);
+        }
+        m.report();
+    }
+    
+    if (!wifi.createTCP(0, HOST_IP, HOST_PORT)) {
+        printf("createTCP failed\n");
+        g_failures++;
+        return;
+    }
+    
+    static const uint32_t send_sizes[] = { 64, 1024, 2048, 8192 };
+    sim.echo_payload = false;
+    for (size_t k = 0; k < sizeof(send_sizes) / sizeof(send_sizes[0]); k++) {
+        uint32_t len = send_sizes[k];
+        char name[32];
+        snprintf(name, sizeof(name), "send %luB", (unsigned long)len);
+        Measure m(name);
+        for (int i = 0; i < n; i++) {
+            fill(out, len, i);
+            bool ok = wifi.send(0, out, len);
+            std::string got = sim.takeSent(0);
+            m.call(ok && got.size() == len && memcmp(got.data(), out, len) == 0, len);
+        }
+        m.report();
+    }
+    
+    {
+        Measure m("send 8192B stream");
+        for (int i = 0; i < n; i++) {
+            FillSource src = { (uint32_t)i, 0 };
+            fill(out, 8192, i);
+            bool ok = wifi.sendStream(0, onSource, &src, 8192);
+            std::string got = sim.takeSent(0);
+            m.call(ok && got.size() == 8192 && memcmp(got.data(), out, 8192) == 0, 8192);
+        }
+        m.report();
+    }
+    
+    {
+        /* A header in flash, a body in RAM and a generated trailer, as 3 sends and as one. */
+        static const char head[] PROGMEM = "POST /log HTTP/1.1\r\nContent-Length: 300\r\n\r\n";
+        const uint32_t head_len = sizeof(head) - 1;
+        std::string expect;
+        fill(out, 200, 0);
+        fill(out + 200, 100, 200);
+        expect.assign(head, head_len);
+        expect.append((const char *)out, 300);
+        {
+            Measure m("send 3 pieces, 3 calls");
+            for (int i = 0; i < n; i++) {
+                uint8_t copy[sizeof(head)];
+                FillSource src = { 200, 0 };
+                memcpy_P(copy, head, head_len);
+                bool ok = wifi.send(0, copy, head_len) && wifi.send(0, out, 200)
+                    && wifi.sendStream(0, onSource, &src, 100);
+                std::string got = sim.takeSent(0);
+                m.call(ok && got == expect, expect.size());
+            }
+            m.report();
+        }
+        {
+            Measure m("send 3 segments");
+            for (int i = 0; i < n; i++) {
+                FillSource src = { 200, 0 };
+                ESP8266Segment segs[3] = {
+                    { ESP8266_SEGMENT_FLASH, head, head_len, NULL },
+                    { ESP8266_SEGMENT_RAM, out, 200, NULL },
+                    { ESP8266_SEGMENT_SOURCE, &src, 100, onSource },
+                };
+                bool ok = wifi.send(0, segs, 3);
+                std::string got = sim.takeSent(0);
+                m.call(ok && got == expect, expect.size());
+            }
+            m.report();
+        }
+    }
+    
+    {
+        /* A sensor log of 16 records of 256B, waiting for each SEND OK or keeping a window. */
+        std::string expect;
+        fill(out, 16 * 256, 3);
+        expect.assign((const char *)out, 16 * 256);
+        {
+            Measure m("log 16x256B, send");
+            for (int i = 0; i < n; i++) {
+                bool ok = true;
+                for (int r = 0; r < 16; r++) {
+                    ok = wifi.send(0, out + r * 256, 256) && ok;
+                }
+                std::string got = sim.takeSent(0);
+                m.call(ok && got == expect, expect.size());
+            }
+            m.report();
+        }
+        for (int full = 0; full < 2; full++) {
+            /* Then a slow network and room for 2: the module refuses and sendBuffered waits. */
+            Measure m(full ? "log 16x256B, module full" : "log 16x256B, buffered");
+            unsigned long refused = sim.sendbuf_refused;
+            if (full) {
+                sim.sendbuf_segments = 2;
+                sim.rtt_us = 1000000;
+            }
+            for (int i = 0; i < n; i++) {
+                bool ok = true;
+                for (int r = 0; r < 16; r++) {
+                    ok = wifi.sendBuffered(0, out + r * 256, 256) && ok;
+                }
+                ok = wifi.flushBuffered(0) && wifi.getBufferedCount(0) == 0 && ok;
+                std::string got = sim.takeSent(0);
+                m.call(ok && got == expect && (!full || sim.sendbuf_refused > refused), expect.size());
+            }
+            m.report();
+        }
+        sim.sendbuf_segments = 8;
+        sim.rtt_us = 20000;
+    }
+    
+    {
+        /* A link that sent 10000 packages already: "1,10000,SEND FAIL" is the longest line. */
+        Measure m("sendBuffered, SEND FAIL");
+        sim.first_segment = 10000;
+        sim.sendbuf_fail = true;
+        for (int i = 0; i < n; i++) {
+            bool ok = wifi.createTCP(1, HOST_IP, HOST_PORT) && wifi.sendBuffered(1, out, 256);
+            ok = !wifi.flushBuffered(1, 500) && wifi.getBufferedCount(1) == 0 && ok;
+            ok = wifi.releaseTCP(1) && ok;
+            sim.takeSent(1);
+            m.call(ok, 256);
+        }
+        m.report();
+        sim.first_segment = 1;
+        sim.sendbuf_fail = false;
+    }
+    
+    static const uint32_t recv_sizes[] = { 64, 512, 1024 };
+    for (size_t k = 0; k < sizeof(recv_sizes) / sizeof(recv_sizes[0]); k++) {
+        uint32_t len = recv_sizes[k];
+        char name[32];
+        snprintf(name, sizeof(name), "recv %luB", (unsigned long)len);
+        Measure m(name);
+        for (int i = 0; i < n; i++) {
+            fill(out, len, i);
+            sim.push(0, out, len);
+            uint32_t got = wifi.recv((uint8_t)0, in, sizeof(in), 5000);
+            m.call(got == len && memcmp(in, out, len) == 0, got);
+        }
+        m.report();
+    }
+    
+    {
+        Measure m("recv 4x16B burst");
+        for (int i = 0; i < n; i++) {
+            uint8_t burst[4][16];
+            for (int f = 0; f < 4; f++) {
+                fill(burst[f], sizeof(burst[f]), i * 4 + f);
+                sim.push(0, burst[f], sizeof(burst[f]));
+            }
+            for (int f = 0; f < 4; f++) {
+                delay(3); /* The sketch is busy while packets arrive */
+                uint32_t got = wifi.recv((uint8_t)0, in, sizeof(in), 5000);
+                m.call(got == sizeof(burst[f]) && memcmp(in, burst[f], got) == 0, got);
+            }
+        }
+        m.report();
+    }
+    
+    {
+        static uint8_t queue1[512];
+        Measure m("recv 2 links interleaved");
+        wifi.createTCP(1, HOST_IP, HOST_PORT);
+        wifi.setRecvBuffer(1, queue1, sizeof(queue1));
+        for (int i = 0; i < n; i++) {
+            uint8_t pkt[4][100];
+            for (int f = 0; f < 4; f++) {
+                fill(pkt[f], sizeof(pkt[f]), i * 4 + f);
+                sim.push(f % 2 ? 0 : 1, pkt[f], sizeof(pkt[f]));
+            }
+            /* Link 0 is read first, link 1 has to wait in its queue. */
+            for (int f = 1; f < 4; f += 2) {
+                uint32_t got = wifi.recv((uint8_t)0, in, sizeof(in), 5000);
+                m.call(got == sizeof(pkt[f]) && memcmp(in, pkt[f], got) == 0, got);
+            }
+            for (int f = 0; f < 4; f += 2) {
+                uint32_t got = wifi.recv((uint8_t)1, in, sizeof(pkt[f]), 5000);
+                m.call(got == sizeof(pkt[f]) && memcmp(in, pkt[f], got) == 0, got);
+            }
+        }
+        m.report();
+        wifi.setRecvBuffer(1, NULL, 0);
+        wifi.releaseTCP(1);
+    }
+    
+    {
+        /* Data and events that come just before a command must survive it. */
+        static uint8_t queue1[64];
+        Measure m("command during traffic");
+        wifi.setRecvBuffer(1, queue1, sizeof(queue1));
+        wifi.getEvents();
+        for (int i = 0; i < n; i++) {
+            uint8_t pkt[16];
+            bool ok = wifi.createTCP(1, HOST_IP, HOST_PORT);
+            fill(pkt, sizeof(pkt), i);
+            sim.push(1, pkt, sizeof(pkt));
+            sim.remoteClose(1);
+            delay(50);
+            ok = wifi.kick() && ok;
+            uint8_t events = wifi.getEvents();
+            uint32_t got = wifi.recv((uint8_t)1, in, sizeof(in), 1000);
+            m.call(ok && got == sizeof(pkt) && memcmp(in, pkt, got) == 0
+                && (events & ESP8266_EVENT_CLOSED) && !wifi.getLinkStatus(1)->open, got);
+        }
+        m.report();
+        wifi.setRecvBuffer(1, NULL, 0);
+    }
+    
+    sim.echo_payload = true;
+    {
+        Measure m("echo 64B round trip");
+        for (int i = 0; i < n; i++) {
+            fill(out, 64, i);
+            bool ok = wifi.send(0, out, 64);
+            uint32_t got = wifi.recv((uint8_t)0, in, sizeof(in), 5000);
+            sim.takeSent(0);
+            m.call(ok && got == 64 && memcmp(in, out, 64) == 0, 128);
+        }
+        m.report();
+    }
+    
+    {
+        /* The loop below stands for the application: it keeps running while the module works. */
+        PollState st;
+        unsigned long loops = 0;
+        Measure m("echo 64B via poll()");
+        wifi.setDataCallback(onData, &st);
+        wifi.setCommandCallback(onCommand, &st);
+        for (int i = 0; i < n; i++) {
+            fill(out, 64, i);
+            st.got = 0;
+            st.done = false;
+            st.ok = false;
+            bool ok = wifi.sendAsync(0, out, 64);
+            unsigned long start = millis();
+            while (ok && (!st.done || st.got < 64) && millis() - start < 5000) {
+                wifi.poll();
+                loops++;
+            }
+            sim.takeSent(0);
+            m.call(ok && st.ok && st.got == 64 && memcmp(st.in, out, 64) == 0, 128);
+        }
+        m.report();
+        wifi.setDataCallback(NULL);
+        wifi.setCommandCallback(NULL);
+        printf("poll: %.0f application loops per op\n", (double)loops / n);
+    }
+    
+    wifi.releaseTCP(0);
+    
+    sim.responder = onHTTP;
+    {
+        ESP8266HTTP http(wifi, 2);
+        std::string got;
+        {
+            Measure m("http GET, new conn");
+            for (int i = 0; i < n; i++) {
+                got.clear();
+                int status = http.request("GET", "example.com", 80, "/len/512",
+                    "Connection: close\r\n", NULL, 0, onBody, &got);
+                m.call(status == 200 && checkBody(got, 512), 512);
+            }
+            m.report();
+        }
+        unsigned long connects = sim.connects;
+        {
+            Measure m("http GET, keep-alive");
+            for (int i = 0; i < n; i++) {
+                got.clear();
+                int status = http.get("example.com", 80, "/len/512", onBody, &got);
+                m.call(status == 200 && checkBody(got, 512), 512);
+            }
+            m.report();
+        }
+        {
+            Measure m("http GET chunked 3000B");
+            for (int i = 0; i < n; i++) {
+                got.clear();
+                int status = http.get("example.com", 80, "/chunked/3000", onBody, &got);
+                m.call(status == 200 && checkBody(got, 3000) && http.getBodyLength() == 3000, 3000);
+            }
+            m.report();
+        }
+        {
+            /* The server drops the kept connection: the next request reconnects once. */
+            Measure m("http GET after close");
+            for (int i = 0; i < n; i++) {
+                sim.remoteClose(2);
+                got.clear();
+                int status = http.get("example.com", 80, "/len/100", onBody, &got);
+                m.call(status == 200 && checkBody(got, 100), 100);
+            }
+            m.report();
+        }
+        printf("http: %lu connections for %d keep-alive requests\n",
+            sim.connects - connects, 3 * n);
+        http.closeAll();
+    }
+    sim.responder = NULL;
+    
+    if (!wifi.disableMUX() || !wifi.createTCP(HOST_IP, HOST_PORT) || !wifi.enterPassthrough()) {
+        printf("passthrough setup failed\n");
+        g_failures++;
+    } else {
+        Stream *pipe = wifi.getPassthroughStream();
+        {
+            Measure m("passthrough echo 64B");
+            sim.echo_payload = true;
+            for (int i = 0; i < n; i++) {
+                uint32_t got = 0;
+                fill(out, 64, i);
+                pipe->write(out, 64);
+                unsigned long start = millis();
+                while (got < 64 && millis() - start < 5000) {
+                    if (pipe->available() > 0) {
+                        in[got++] = pipe->read();
+                    }
+                }
+                sim.takeSent(0);
+                m.call(got == 64 && memcmp(in, out, 64) == 0, 128);
+            }
+            m.report();
+        }
+        {
+            Measure m("passthrough send 8192B");
+            sim.echo_payload = false;
+            for (int i = 0; i < n; i++) {
+                fill(out, 8192, i);
+                pipe->write(out, 8192);
+                pipe->flush();
+                std::string got = sim.takeSent(0);
+                m.call(got.size() == 8192 && memcmp(got.data(), out, 8192) == 0, 8192);
+            }
+            m.report();
+        }
+        {
+            Measure m("exitPassthrough");
+            m.call(wifi.exitPassthrough() && !sim.passthrough());
+            m.report();
+        }
+    }
+    wifi.releaseTCP();
+    wifi.enableMUX();
+    printf("uart: tx %lu B, rx %lu B, rx overflows %lu, idle polls %lu\n",
+        rig.uart.txBytes(), rig.uart.rxBytes(), rig.uart.rxOverflows(), rig.uart.idlePolls());
+#ifdef ESP8266_USE_STATS
+    printStats(wifi);
+#endif
+#if ESP8266_TRACE_LEVEL > 0
+    wifi.dumpTrace(Serial);
+#endif
+}
+
+/*
+ * A UART that serves bytes from memory with no timing, to measure the cost of 
+ * the driver's receive path alone. 
+ */
+class MemoryUart : public HardwareSerial {
+ public:
+    MemoryUart(void): m_pos(0) {}
+    
+    void load(const std::string &data) { m_data = data; m_pos = 0; }
+    virtual int available(void) { return (int)(m_data.size() - m_pos); }
+    virtual int read(void) { return m_pos < m_data.size() ? (uint8_t)m_data[m_pos++] : -1; }
+    virtual int peek(void) { return m_pos < m_data.size() ? (uint8_t)m_data[m_pos] : -1; }
+    virtual size_t write(uint8_t c) { return 1; }
+    virtual size_t write(const uint8_t *buffer, size_t size) { return size; }
+    virtual void flush(void) {}
+    
+ private:
+    std::string m_data;
+    size_t m_pos;
+};
+
+static void runReceivePath(int n)
+{
+    MemoryUart uart;
+    ESP8266 wifi(uart, 115200);
+    uint8_t payload[1024];
+    uint8_t in[1024];
+    std::string frames;
+    unsigned long fail = 0;
+    int rounds = n * 40;
+    
+    fill(payload, sizeof(payload), 7);
+    for (int f = 0; f < 8; f++) {
+        frames += "+IPD,1024:";
+        frames.append((const char *)payload, sizeof(payload));
+        frames += "\r\nOK\r\n";
+    }
+    double cpu0 = cpu_us();
+    for (int i = 0; i < rounds; i++) {
+        uart.load(frames);
+        for (int f = 0; f < 8; f++) {
+            if (wifi.recv(in, sizeof(in), 100) != sizeof(in) || memcmp(in, payload, sizeof(in)) != 0) {
+                fail++;
+            }
+        }
+    }
+    double ns = (cpu_us() - cpu0) * 1000.0 / ((double)rounds * frames.size());
+    {
+        /* With AT+CIPDINFO=1 the header ends with the remote address, in both modes. */
+        std::string info = "+IPD,3,192.168.1.7,8090:abc\r\n+IPD,1024,192.168.1.7,8090:";
+        uint8_t id = 0xFF;
+        info.append((const char *)payload, sizeof(payload));
+        info += "\r\n+IPD,2,3,\"192.168.1.7\",8090:xyz\r\n+IPD,2,\"192.168.1.7\",8090:uv\r\n";
+        uart.load(info);
+        if (wifi.recv(in, sizeof(in), 100) != 3 || memcmp(in, "abc", 3) != 0) {
+            fail++;
+        }
+        if (wifi.recv(in, sizeof(in), 100) != sizeof(payload) || memcmp(in, payload, sizeof(payload)) != 0) {
+            fail++;
+        }
+        if (wifi.recv(&id, in, sizeof(in), 100) != 3 || id != 2 || memcmp(in, "xyz", 3) != 0) {
+            fail++;
+        }
+        if (wifi.recv(in, sizeof(in), 100) != 2 || memcmp(in, "uv", 2) != 0) {
+            fail++;
+        }
+    }
+    printf("\n== receive path from memory, no UART timing ==\n");
+    printf("%lu bytes, %.2f cpu ns/byte, %lu failed\n", (unsigned long)rounds * frames.size(), ns, fail);
+    g_failures += fail;
+}
+
+/*
+ * Start at 9600 like a fresh module, upgrade with setUARTBaud and measure what the
+ * new rate gives. The emulated receiver misreads above 460800, so 921600 must fall back.
+ */
+static void runUpgrade(int n)
+{
+    static const uint32_t rates[] = { 115200, 230400, 460800, 921600 };
+    const uint32_t max_baud = 460800;
+    uint8_t out[2048];
+    uint8_t in[2048];
+    
+    printf("\n== setUARTBaud from 9600, receiver limit %lu ==\n", (unsigned long)max_baud);
+    printf("%-24s %6s %11s %10s %10s %11s %5s\n",
+        "test", "calls", "virt ms/op", "ops/s", "KB/s", "cpu us/op", "fail");
+    for (size_t k = 0; k < sizeof(rates) / sizeof(rates[0]); k++) {
+        Rig rig(9600);
+        ESP8266 &wifi = rig.wifi;
+        ESP8266Sim &sim = rig.sim;
+        bool expected = rates[k] <= max_baud;
+        char name[32];
+        
+        sim.max_baud = max_baud;
+        sim.echo_payload = false;
+        if (!wifi.kick() || !wifi.joinAP(SSID, PASSWORD) || !wifi.enableMUX() 
+            || !wifi.createTCP(0, HOST_IP, HOST_PORT)) {
+            printf("setup failed\n");
+            g_failures++;
+            continue;
+        }
+        {
+            snprintf(name, sizeof(name), "setUARTBaud %lu", (unsigned long)rates[k]);
+            Measure m(name);
+            bool ok = wifi.setUARTBaud(rates[k]);
+            uint32_t rate = wifi.getUARTBaud();
+            m.call(ok == expected && rate == (expected ? rates[k] : 9600) && wifi.kick());
+            m.report();
+        }
+        {
+            snprintf(name, sizeof(name), "  send 2048B @%lu", (unsigned long)wifi.getUARTBaud());
+            Measure m(name);
+            for (int i = 0; i < n; i++) {
+                fill(out, sizeof(out), i);
+                bool ok = wifi.send(0, out, sizeof(out));
+                std::string got = sim.takeSent(0);
+                m.call(ok && got.size() == sizeof(out) && memcmp(got.data(), out, sizeof(out)) == 0, sizeof(out));
+            }
+            m.report();
+        }
+        {
+            snprintf(name, sizeof(name), "  recv 1024B @%lu", (unsigned long)wifi.getUARTBaud());
+            Measure m(name);
+            for (int i = 0; i < n; i++) {
+                fill(out, 1024, i);
+                sim.push(0, out, 1024);
+                uint32_t got = wifi.recv((uint8_t)0, in, sizeof(in), 5000);
+                m.call(got == 1024 && memcmp(in, out, 1024) == 0, got);
+            }
+            m.report();
+        }
+    }
+}
+
+/*
+ * restart() and the reconfigurations that need one on older firmwares: they 
+ * should cost the boot time of the module(boot_us), not fixed sleeps, and 
+ * nothing at all where the firmware does without. 
+ */
+static void runRestart(int n, bool legacy)
+{
+    Rig rig(115200);
+    ESP8266 &wifi = rig.wifi;
+    ESP8266Sim &sim = rig.sim;
+    uint32_t boot_ms = sim.boot_us / 1000;
+    
+    printf("\n== restart and reconfiguration, %s firmware booting in %lu ms ==\n",
+        legacy ? "0.9.x" : "1.x", (unsigned long)boot_ms);
+    printf("%-24s %6s %11s %10s %10s %11s %5s\n",
+        "test", "calls", "virt ms/op", "ops/s", "KB/s", "cpu us/op", "fail");
+    sim.legacy = legacy;
+    if (!wifi.kick()) {
+        printf("setup failed\n");
+        g_failures++;
+        return;
+    }
+    {
+        Measure m("restart");
+        for (int i = 0; i < n; i++) {
+            bool ok = wifi.restart();
+            uint32_t t = wifi.getBootTime();
+            m.call(ok && t >= boot_ms && t < boot_ms + 100 && wifi.kick());
+        }
+        m.report();
+    }
+    {
+        /* The READY of a reset not read yet survives a restart that prints no banner. */
+        Measure m("restart, READY unread");
+        for (int i = 0; i < n; i++) {
+            bool ok = wifi.restart();
+            sim.banner = false;
+            ok = wifi.restart() && ok;
+            sim.banner = true;
+            m.call(ok && (wifi.getEvents() & ESP8266_EVENT_READY));
+        }
+        m.report();
+    }
+    if (!wifi.joinAP(SSID, PASSWORD) || !wifi.enableMUX()) {
+        printf("setup failed\n");
+        g_failures++;
+        return;
+    }
+    {
+        /* A link on mux_id 0 survives unless the firmware needs a restart. */
+        Measure m("setOprTo* change");
+        for (int i = 0; i < n; i++) {
+            bool ok = (legacy || wifi.createTCP(0, HOST_IP, HOST_PORT))
+                && ((i & 1) ? wifi.setOprToStation() : wifi.setOprToSoftAP());
+            m.call(ok && sim.linkOpen(0) == !legacy && wifi.isLinkOpen(0) == !legacy);
+            if (legacy) {
+                wifi.enableMUX();
+            } else {
+                wifi.releaseTCP(0);
+            }
+        }
+        m.report();
+    }
+    {
+        Measure m("stopTCPServer");
+        for (int i = 0; i < n; i++) {
+            bool ok = wifi.startTCPServer(8080) && wifi.createTCP(0, HOST_IP, HOST_PORT);
+            ok = ok && wifi.stopTCPServer();
+            m.call(ok && sim.linkOpen(0) == !legacy && wifi.isLinkOpen(0) == !legacy);
+            if (legacy) {
+                wifi.enableMUX();
+            } else {
+                wifi.releaseTCP(0);
+            }
+        }
+        m.report();
+    }
+    {
+        /* Refused in single mode: an ERROR is no reason to restart. */
+        Measure m("stopTCPServer, ERROR");
+        for (int i = 0; i < n; i++) {
+            bool ok = wifi.disableMUX();
+            wifi.getEvents();
+            ok = !wifi.stopTCPServer() && !(wifi.getEvents() & ESP8266_EVENT_READY) && ok;
+            m.call(wifi.enableMUX() && ok);
+        }
+        m.report();
+    }
+}
+
+/*
+ * Rejoining the AP: a full join scans and asks DHCP, joinAPFast skips what its 
+ * cache allows and falls back when the AP has moved. 
+ */
+static void runJoin(int n)
+{
+    static const uint8_t itead[6] = { 0xc8, 0x3a, 0x35, 0x01, 0x02, 0x03 };
+    static const uint8_t lease[4] = { 192, 168, 1, 100 };
+    Rig rig(115200);
+    ESP8266 &wifi = rig.wifi;
+    ESP8266JoinCache cache;
+    
+    printf("\n== join, full join takes %lu ms ==\n", (unsigned long)(rig.sim.join_us / 1000));
+    printf("%-24s %6s %11s %10s %10s %11s %5s\n",
+        "test", "calls", "virt ms/op", "ops/s", "KB/s", "cpu us/op", "fail");
+    if (!wifi.kick()) {
+        printf("setup failed\n");
+        g_failures++;
+        return;
+    }
+    {
+        Measure m("joinAP");
+        for (int i = 0; i < n; i++) {
+            m.call(wifi.leaveAP() && wifi.joinAP(SSID, PASSWORD));
+        }
+        m.report();
+    }
+    {
+        Measure m("joinAPFast, empty cache");
+        memset(&cache, 0, sizeof(cache));
+        wifi.leaveAP();
+        bool ok = wifi.joinAPFast(SSID, PASSWORD, &cache);
+        m.call(ok && cache.valid && !memcmp(cache.bssid, itead, 6) && cache.channel == 1
+            && !memcmp(cache.ip, lease, 4) && cache.netmask[3] == 0);
+        m.report();
+    }
+    for (int fixed = 0; fixed < 2; fixed++) {
+        Measure m(fixed ? "joinAPFast, BSSID + IP" : "joinAPFast, BSSID");
+        uint32_t took = 0;
+        for (int i = 0; i < n; i++) {
+            bool ok = wifi.leaveAP() && wifi.joinAPFast(SSID, PASSWORD, &cache, fixed);
+            took += wifi.getJoinTime();
+            m.call(ok && wifi.getLocalIP().indexOf("192.168.1.100") >= 0);
+        }
+        m.report();
+        printf("  join time %lu ms\n", (unsigned long)(took / n));
+    }
+    {
+        /* The cached AP is gone: the quick join fails and a full one refills the cache. */
+        Measure m("joinAPFast, AP moved");
+        for (int i = 0; i < n; i++) {
+            cache.bssid[5] ^= 0xFF;
+            bool ok = wifi.leaveAP() && wifi.joinAPFast(SSID, PASSWORD, &cache);
+            m.call(ok && cache.valid && !memcmp(cache.bssid, itead, 6));
+        }
+        m.report();
+    }
+}
+
+static void runDNS(int n)
+{
+    static const uint8_t moved[2][4] = { { 10, 0, 0, 1 }, { 10, 0, 0, 2 } };
+    Rig rig(115200);
+    ESP8266 &wifi = rig.wifi;
+    ESP8266Sim &sim = rig.sim;
+    uint8_t ip[4];
+    
+    printf("\n== host names, lookup takes %lu ms ==\n", (unsigned long)(sim.dns_us / 1000));
+    printf("%-24s %6s %11s %10s %10s %11s %5s\n",
+        "test", "calls", "virt ms/op", "ops/s", "KB/s", "cpu us/op", "fail");
+    if (!wifi.kick() || !wifi.joinAP(SSID, PASSWORD) || !wifi.enableMUX()) {
+        printf("setup failed\n");
+        g_failures++;
+        return;
+    }
+    for (int ttl = 0; ttl < 2; ttl++) {
+        Measure m(ttl ? "createTCP name, cached" : "createTCP name, no cache");
+        unsigned long lookups = sim.lookups;
+        wifi.setDNSCacheTTL(ttl ? 300 : 0);
+        for (int i = 0; i < n; i++) {
+            bool ok = wifi.createTCP(1, "example.com", HOST_PORT);
+            ok = wifi.releaseTCP(1) && ok;
+            m.call(ok);
+        }
+        m.call(sim.lookups - lookups == (ttl ? 1UL : (unsigned long)n));
+        m.report();
+    }
+    {
+        /* A cached name needs no AT+CIPDOMAIN before an asynchronous AT+CIPSTART. */
+        Measure m("createTCPAsync, cached");
+        unsigned long lookups = sim.lookups;
+        for (int i = 0; i < n; i++) {
+            bool ok = wifi.createTCPAsync(1, "example.com", HOST_PORT);
+            while (wifi.isBusy()) {
+                wifi.poll();
+            }
+            ok = ok && wifi.isLinkOpen(1);
+            ok = wifi.releaseTCP(1) && ok;
+            m.call(ok);
+        }
+        m.call(sim.lookups == lookups);
+        m.report();
+    }
+    {
+        Measure m("resolveHost");
+        sim.hosts["api.example.com"] = "10.0.0.1";
+        m.call(wifi.resolveHost(HOST_IP, ip) && ip[0] == 172 && ip[3] == 12);
+        m.call(wifi.resolveHost("api.example.com", ip) && !memcmp(ip, moved[0], 4));
+        m.call(!wifi.resolveHost("bad.example.com", ip));
+        sim.quote_domain = true;
+        sim.hosts["quoted.example.com"] = "10.0.0.2";
+        m.call(wifi.resolveHost("quoted.example.com", ip) && !memcmp(ip, moved[1], 4));
+        sim.quote_domain = false;
+        m.report();
+    }
+    {
+        /* A TTL past what fits in ms is cut, not wrapped to a short one. */
+        Measure m("resolveHost, long TTL");
+        wifi.setDNSCacheTTL(4294968UL);
+        m.call(wifi.resolveHost("api.example.com", ip));
+        unsigned long lookups = sim.lookups;
+        delay(1000);
+        m.call(wifi.resolveHost("api.example.com", ip) && sim.lookups == lookups);
+        wifi.setDNSCacheTTL(300);
+        m.report();
+    }
+    {
+        /* The connection to the old address fails and drops it: the next one looks the name up. */
+        Measure m("createTCP, host moved");
+        for (int i = 0; i < n; i++) {
+            int to = (i + 1) % 2;
+            sim.hosts["api.example.com"] = to ? "10.0.0.2" : "10.0.0.1";
+            sim.down.clear();
+            sim.down.insert(to ? "10.0.0.1" : "10.0.0.2");
+            bool failed = !wifi.createTCP(1, "api.example.com", HOST_PORT);
+            bool ok = failed && wifi.createTCP(1, "api.example.com", HOST_PORT)
+                && wifi.resolveHost("api.example.com", ip) && !memcmp(ip, moved[to], 4);
+            ok = wifi.releaseTCP(1) && ok;
+            m.call(ok);
+        }
+        m.report();
+    }
+    {
+        /* A failed or garbled lookup leaves the entry it would have replaced as it was. */
+        Measure m("failed lookup, full cache");
+        static const char *names[] = { "a.example.com", "b.example.com", "c.example.com", "d.example.com" };
+        wifi.flushDNSCache();
+        for (int i = 0; i < ESP8266_DNS_CACHE && i < 4; i++) {
+            sim.hosts[names[i]] = i ? "10.0.0.2" : "10.0.0.1";
+            m.call(wifi.resolveHost(names[i], ip));
+            delay(10);
+        }
+        m.call(!wifi.createTCP(1, "bad.example.com", HOST_PORT));
+        sim.hosts["short.example.com"] = "10.9";
+        m.call(!wifi.resolveHost("short.example.com", ip));
+        unsigned long lookups = sim.lookups;
+        m.call(wifi.resolveHost(names[0], ip) && !memcmp(ip, moved[0], 4) && sim.lookups == lookups);
+        m.report();
+    }
+}
+
+/* Bytes received on each link of the pool */
+static void onPoolData(uint8_t id, const uint8_t *data, uint32_t len, void *arg)
+{
+    ((uint32_t *)arg)[id] += len;
+}
+
+static void runPool(int n)
+{
+    static const int sizes[] = { 1, 2, 4 };
+    static const int LINKS = 2;     /* per module */
+    static const uint32_t PKG = 512;
+    uint8_t out[1460];
+    
+    printf("\n== module pool, %d links per module at 115200 ==\n", LINKS);
+    printf("%-24s %6s %11s %10s %10s %11s %5s\n",
+        "test", "calls", "virt ms/op", "ops/s", "KB/s", "cpu us/op", "fail");
+    fill(out, sizeof(out), 7);
+    for (size_t k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++) {
+        int modules = sizes[k];
+        std::vector<Rig *> rigs;
+        PollState st[ESP8266POOL_MODULES];
+        uint32_t got[ESP8266POOL_MODULES * ESP8266POOL_MUX];
+        uint32_t left[ESP8266POOL_MODULES * ESP8266POOL_MUX];
+        std::vector<int> ids;
+        ESP8266Pool pool;
+        bool ok = true;
+        char name[32];
+        
+        memset(got, 0, sizeof(got));
+        pool.setDataCallback(onPoolData, got);
+        for (int i = 0; i < modules; i++) {
+            Rig *rig = new Rig(115200);
+            rigs.push_back(rig);
+            rig->sim.echo_payload = false;
+            ok = ok && rig->wifi.kick() && rig->wifi.joinAP(SSID, PASSWORD) && rig->wifi.enableMUX()
+                && pool.add(rig->wifi);
+        }
+        {
+            /* Each new link goes to the module with the fewest. */
+            snprintf(name, sizeof(name), "createTCP x%d", modules);
+            Measure m(name);
+            for (int i = 0; i < modules * LINKS; i++) {
+                int id = pool.createTCP(HOST_IP, HOST_PORT);
+                m.call(ok && id >= 0);
+                ids.push_back(id);
+            }
+            for (int i = 0; i < modules; i++) {
+                m.call(pool.getLinkCount(i) == LINKS);
+            }
+            m.report();
+        }
+        for (size_t i = 0; i < ids.size(); i++) {
+            if (ids[i] < 0) {
+                ok = false;
+            }
+        }
+        if (!ok) {
+            for (int i = 0; i < modules; i++) {
+                delete rigs[i];
+            }
+            continue;
+        }
+        {
+            /* One package in flight per module: while one waits for SEND OK, the others send. */
+            snprintf(name, sizeof(name), "send %uB x%d", (unsigned)PKG, modules);
+            Measure m(name);
+            bool busy[ESP8266POOL_MODULES] = { false };
+            unsigned long start = millis();
+            bool more = true;
+            for (int i = 0; i < modules; i++) {
+                rigs[i]->wifi.setCommandCallback(onCommand, &st[i]);
+            }
+            for (size_t i = 0; i < ids.size(); i++) {
+                left[ids[i]] = n * PKG;
+            }
+            while (more && millis() - start < 60000) {
+                more = false;
+                for (size_t i = 0; i < ids.size(); i++) {
+                    int id = ids[i];
+                    int mod = id / ESP8266POOL_MUX;
+                    if (left[id] > 0 && !busy[mod] && pool.sendAsync(id, out, PKG)) {
+                        busy[mod] = true;
+                        st[mod].done = false;
+                        left[id] -= PKG;
+                    }
+                    more = more || left[id] > 0;
+                }
+                pool.poll();
+                for (int i = 0; i < modules; i++) {
+                    if (busy[i] && st[i].done) {
+                        busy[i] = false;
+                        m.call(st[i].ok, PKG);
+                    }
+                    more = more || busy[i];
+                }
+            }
+            for (size_t i = 0; i < ids.size(); i++) {
+                m.call(rigs[ids[i] / ESP8266POOL_MUX]->sim.takeSent(ids[i] % ESP8266POOL_MUX).size() == n * PKG);
+            }
+            m.report();
+            for (int i = 0; i < modules; i++) {
+                rigs[i]->wifi.setCommandCallback(NULL);
+            }
+        }
+        {
+            /* The server sends on every link at once; all modules are read in turn. */
+            snprintf(name, sizeof(name), "recv 1460B x%d", modules);
+            Measure m(name);
+            unsigned long start = millis();
+            bool more = true;
+            for (size_t i = 0; i < ids.size(); i++) {
+                for (int j = 0; j < n; j++) {
+                    rigs[ids[i] / ESP8266POOL_MUX]->sim.push(ids[i] % ESP8266POOL_MUX, out, sizeof(out));
+                }
+            }
+            while (more && millis() - start < 60000) {
+                pool.poll();
+                more = false;
+                for (size_t i = 0; i < ids.size(); i++) {
+                    more = more || got[ids[i]] < n * sizeof(out);
+                }
+            }
+            for (size_t i = 0; i < ids.size(); i++) {
+                m.call(got[ids[i]] == n * sizeof(out), got[ids[i]]);
+            }
+            m.report();
+        }
+        if (modules > 1) {
+            /* A 2 s lookup on the first module: the others are read while createTCP waits for it. */
+            snprintf(name, sizeof(name), "createTCP slow x%d", modules);
+            Measure m(name);
+            unsigned long overflows = 0;
+            uint32_t want = 3 * sizeof(out);
+            rigs[0]->sim.dns_us = 2000000;
+            memset(got, 0, sizeof(got));
+            for (int i = 1; i < modules; i++) {
+                rigs[i]->uart.resetCounters();
+                for (int j = 0; j < 3; j++) {
+                    rigs[i]->sim.push(ids[i] % ESP8266POOL_MUX, out, sizeof(out));
+                }
+            }
+            int id = pool.createTCP("slow.example.com", HOST_PORT);
+            m.call(id >= 0 && id < ESP8266POOL_MUX);
+            unsigned long start = millis();
+            while (millis() - start < 1000) {
+                pool.poll();
+            }
+            for (int i = 1; i < modules; i++) {
+                overflows += rigs[i]->uart.rxOverflows();
+                m.call(got[ids[i]] == want && rigs[i]->uart.rxOverflows() == 0, got[ids[i]]);
+            }
+            m.report();
+            printf("  UART overflow of the other modules %lu\n", overflows);
+            if (id >= 0) {
+                pool.releaseTCP(id);
+            }
+        }
+        for (size_t i = 0; i < ids.size(); i++) {
+            pool.releaseTCP(ids[i]);
+        }
+        for (int i = 0; i < modules; i++) {
+            delete rigs[i];
+        }
+    }
+}
+
+static void runSequence(uint32_t baud, int n)
+{
+    String ip;
+    ESP8266Step steps[] = {
+        { ESP8266_CMD_AT, NULL, NULL, false, 0 },
+        { ESP8266_CMD_CWMODE, "_CUR=1", NULL, false, 0 },
+        { ESP8266_CMD_CWJAP, "_CUR=\"" SSID "\",\"" PASSWORD "\"", NULL, false, 0 },
+        { ESP8266_CMD_CIPMUX, "=1", NULL, false, 0 },
+        { ESP8266_CMD_CIPSTO, "=180", NULL, false, 0 },
+        { ESP8266_CMD_CIPSERVER, "=1,8090", NULL, false, 0 },
+        { ESP8266_CMD_CIFSR, NULL, &ip, false, 0 },
+    };
+    const uint8_t count = sizeof(steps) / sizeof(steps[0]);
+    uint32_t step_time[count];
+    
+    printf("\n== bringing up a module found in soft-AP mode, baud %lu ==\n", (unsigned long)baud);
+    printf("%-24s %6s %11s %10s %10s %11s %5s\n",
+        "test", "calls", "virt ms/op", "ops/s", "KB/s", "cpu us/op", "fail");
+    memset(step_time, 0, sizeof(step_time));
+    for (int seq = 0; seq < 2; seq++) {
+        Measure m(seq ? "runSequence" : "one method at a time");
+        uint64_t spent = 0;
+        uint64_t join = 0;
+        for (int i = 0; i < n; i++) {
+            Rig rig(baud);
+            ESP8266 &wifi = rig.wifi;
+            bool ok;
+            {
+                /* Another driver leaves the module in soft-AP mode, so the one tested knows nothing yet. */
+                ESP8266 prep(rig.uart, baud);
+                prep.setOprToSoftAP();
+            }
+            uint64_t start = sim_now_us();
+            if (seq) {
+                ok = wifi.runSequence(steps, count) == count;
+                for (uint8_t j = 0; j < count; j++) {
+                    step_time[j] += steps[j].time;
+                }
+                join += steps[2].time;
+            } else {
+                ok = wifi.kick() && wifi.setOprToStation() && wifi.joinAP(SSID, PASSWORD)
+                    && wifi.enableMUX() && wifi.setTCPServerTimeout(180) && wifi.startTCPServer(8090);
+                ip = wifi.getLocalIP();
+                join += wifi.getJoinTime();
+            }
+            spent += sim_now_us() - start;
+            m.call(ok && ip.indexOf("192.168.1.100") >= 0);
+        }
+        m.report();
+        printf("  bring-up %.1f ms, %.1f ms of it besides the join\n",
+            spent / 1000.0 / n, (spent / 1000.0 - join) / n);
+        if (seq) {
+            printf("  steps:");
+            for (uint8_t j = 0; j < count; j++) {
+                printf(" %s %.1f", commandName(steps[j].command), step_time[j] / (double)n);
+            }
+            printf(" ms\n");
+        }
+    }
+    {
+        /* The run stops at the first failure and leaves the rest alone. */
+        Measure m("runSequence, bad AP");
+        ESP8266Step bad[] = {
+            { ESP8266_CMD_AT, NULL, NULL, false, 0 },
+            { ESP8266_CMD_CWJAP, "_CUR=\"nowhere\",\"x\"", NULL, false, 0 },
+            { ESP8266_CMD_CIPMUX, "=1", NULL, false, 0 },
+        };
+        Rig rig(baud);
+        m.call(rig.wifi.runSequence(bad, 3) == 1 && bad[0].ok && !bad[1].ok && bad[1].time > 0
+            && !bad[2].ok && bad[2].time == 0);
+        m.call(!rig.wifi.runSequenceAsync(bad, 0) || !rig.wifi.isBusy());
+        m.report();
+    }
+    {
+        /* A command which can not be a step is told apart from a module failing the first step. */
+        Measure m("runSequence, refused");
+        ESP8266Step refused[] = {
+            { ESP8266_CMD_AT, NULL, NULL, false, 0 },
+            { ESP8266_CMD_RST, NULL, NULL, false, 0 },
+        };
+        ESP8266Step failing[] = {
+            { ESP8266_CMD_CWJAP, "_CUR=\"nowhere\",\"x\"", NULL, false, 0 },
+        };
+        Rig rig(baud);
+        unsigned long commands = rig.sim.commands;
+        m.call(rig.wifi.runSequence(refused, 2) == ESP8266_SEQUENCE_REFUSED && rig.sim.commands == commands);
+        m.call(rig.wifi.runSequence(failing, 1) == 0);
+        m.report();
+    }
+}
+
+/* State shared with the data callback of the receive ring test */
+struct RingState {
+    const uint8_t *expect;
+    uint32_t expect_len;
+    uint32_t got;
+    uint32_t bad;
+};
+
+static void onRingData(uint8_t mux_id, const uint8_t *data, uint32_t len, void *arg)
+{
+    RingState *st = (RingState *)arg;
+    for (uint32_t i = 0; i < len; i++) {
+        if (data[i] != st->expect[(st->got + i) % st->expect_len]) {
+            st->bad++;
+        }
+    }
+    st->got += len;
+}
+
+/* Stands for a timer interrupt during blocking calls */
+static void onPumpIdle(void *arg)
+{
+    ((ESP8266 *)arg)->pump();
+}
+
+static void runRxRing(uint32_t baud, int n)
+{
+    static const uint32_t PKG = 1024;
+    static const unsigned long WORK = 20;  /* ms the sketch spends between polls */
+    static const struct {
+        const char *name;
+        uint16_t ring;
+        bool pump;
+    } cases[] = {
+        { "busy, UART only", 0, false },
+        { "busy, ring 2KB + pump", 2048, true },
+        { "busy, ring 128B + pump", 128, true },
+    };
+    uint8_t out[PKG];
+    static uint8_t ring[2048];
+    
+    printf("\n== sketch busy %lu ms between polls, %d x %uB at baud %lu ==\n",
+        WORK, n, (unsigned)PKG, (unsigned long)baud);
+    printf("%-24s %6s %11s %10s %10s %11s %5s\n",
+        "test", "calls", "virt ms/op", "ops/s", "KB/s", "cpu us/op", "fail");
+    fill(out, sizeof(out), 3);
+    for (size_t k = 0; k < sizeof(cases) / sizeof(cases[0]); k++) {
+        Rig rig(baud);
+        ESP8266 &wifi = rig.wifi;
+        RingState st = { out, PKG, 0, 0 };
+        uint32_t total = n * PKG;
+        bool ok;
+        
+        wifi.setRxRing(cases[k].ring ? ring : NULL, cases[k].ring);
+        ok = wifi.kick() && wifi.joinAP(SSID, PASSWORD) && wifi.enableMUX()
+            && wifi.createTCP(0, HOST_IP, HOST_PORT);
+        wifi.setDataCallback(onRingData, &st);
+        rig.uart.resetCounters();
+        Measure m(cases[k].name);
+        for (int i = 0; i < n; i++) {
+            rig.sim.push(0, out, PKG);
+        }
+        unsigned long start = millis();
+        while (st.got < total && millis() - start < total / (baud / 10000) + 1000) {
+            wifi.poll();
+            /* The work: pump in place of a timer interrupt every ms. */
+            for (unsigned long t = 0; t < WORK; t++) {
+                delay(1);
+                if (cases[k].pump) {
+                    wifi.pump();
+                }
+            }
+        }
+        if (cases[k].ring == sizeof(ring)) {
+            /* A ring larger than the data of one work period loses nothing. */
+            m.call(ok && st.got == total && st.bad == 0 && rig.uart.rxOverflows() == 0
+                && wifi.getRxRingOverflow() == 0, st.got);
+        } else if (cases[k].ring) {
+            /* Too small a ring: the losses are counted. */
+            m.call(ok && st.got < total && wifi.getRxRingOverflow() > 0 && rig.uart.rxOverflows() == 0, st.got);
+        } else {
+            m.call(ok, st.got);
+        }
+        m.report();
+        printf("  received %lu of %lu, UART overflow %lu, ring overflow %lu\n",
+            (unsigned long)st.got, (unsigned long)total, rig.uart.rxOverflows(),
+            (unsigned long)wifi.getRxRingOverflow());
+    }
+    {
+        /* pump keeps running through passthrough entry: the stream still gets every byte after the prompt. */
+        Measure m("passthrough, ring + pump");
+        Rig rig(baud);
+        ESP8266 &wifi = rig.wifi;
+        uint8_t in[PKG];
+        uint32_t got = 0;
+        Stream *pipe;
+        
+        wifi.setRxRing(ring, sizeof(ring));
+        wifi.setIdleCallback(onPumpIdle, &wifi);
+        m.call(wifi.kick() && wifi.joinAP(SSID, PASSWORD) && wifi.createTCP(HOST_IP, HOST_PORT)
+            && wifi.enterPassthrough());
+        pipe = wifi.getPassthroughStream();
+        if (pipe) {
+            rig.sim.push(0, out, PKG);
+            unsigned long start = millis();
+            while (got < PKG && millis() - start < 1000) {
+                wifi.pump();
+                while (got < PKG && pipe->available() > 0) {
+                    in[got++] = pipe->read();
+                }
+            }
+            m.call(got == PKG && !memcmp(in, out, PKG), got);
+            m.call(wifi.exitPassthrough() && wifi.getRxRingOverflow() == 0);
+        }
+        m.report();
+    }
+}
+
+int main(int argc, char **argv)
+{
+    std::vector<uint32_t> bauds;
+    int n = 50;
+    
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-b") && i + 1 < argc) {
+            bauds.push_back(strtoul(argv[++i], NULL, 10));
+        } else if (!strcmp(argv[i], "-n") && i + 1 < argc) {
+            n = atoi(argv[++i]);
+        } else {
+            fprintf(stderr, "usage: %s [-b baud]... [-n iterations]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (bauds.empty()) {
+        bauds.push_back(9600);
+        bauds.push_back(115200);
+    }
+    
+    printf("WeeESP8266 host benchmark, %d iterations per test\n", n);
+    for (size_t i = 0; i < bauds.size(); i++) {
+        run(bauds[i], n);
+    }
+    runUpgrade(n);
+    runRestart(n, true);
+    runRestart(n, false);
+    runJoin(n);
+    runDNS(n);
+    runPool(n);
+    runSequence(9600, n);
+    runSequence(115200, n);
+    runRxRing(115200, n);
+    runReceivePath(n);
+    if (g_failures) {
+        printf("\n%lu failed calls\n", g_failures);
+        return 1;
+    }
+    return 0;
+}
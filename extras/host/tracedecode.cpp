@@ -0,0 +1,119 @@
+/**
+ * @file tracedecode.cpp
+ * @brief Decoder of the trace ring printed by ESP8266::dumpTrace.
+ *
+ * Reads a log (a serial monitor capture, for example) from the files given
+ * or stdin, and prints the entries found between "ESP8266 TRACE BEGIN" and
+ * "ESP8266 TRACE END" with their time relative to the first entry of the
+ * dump and to the previous one. Other lines are ignored.
+ *
+ * Usage: tracedecode [file]...
+ *
+ * @par Copyright:
+ * Copyright (c) 2026 WeeESP8266 contributors. \n\n
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of
+ * the License, or (at your option) any later version.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#undef ESP8266_TRACE_LEVEL
+#define ESP8266_TRACE_LEVEL     (3)
+
+#include "CommandNames.h"
+#include "ESP8266.h"
+
+static const char *const RESULTS[] = { "OK", "OK", "FAIL" };
+static const char *const WIFI_STATES[] = { "DISCONNECTED", "CONNECTED", "GOT IP" };
+
+static void describe(unsigned code, unsigned a, unsigned b, char *buf, size_t size)
+{
+    char mux[8];
+    
+    if (a == 0xFF) {
+        snprintf(mux, sizeof(mux), "-");
+    } else {
+        snprintf(mux, sizeof(mux), "%u", a);
+    }
+    switch (code) {
+    case ESP8266_TRACE_TX:
+        snprintf(buf, size, "TX       %s", commandName(a));
+        break;
+    case ESP8266_TRACE_RX:
+        snprintf(buf, size, "RX       %s %s", commandName(a), b < 3 ? RESULTS[b] : "?");
+        break;
+    case ESP8266_TRACE_TIMEOUT:
+        snprintf(buf, size, "TIMEOUT  %s after %u ms", commandName(a), b);
+        break;
+    case ESP8266_TRACE_IPD:
+        snprintf(buf, size, "+IPD     mux %s, %u B", mux, b);
+        break;
+    case ESP8266_TRACE_SEND:
+        snprintf(buf, size, "SEND     mux %s, %u B", mux, b);
+        break;
+    case ESP8266_TRACE_DROP:
+        snprintf(buf, size, "DROP     mux %u, %u B", a, b);
+        break;
+    case ESP8266_TRACE_LINK:
+        snprintf(buf, size, "LINK     mux %u %s", a, b ? "CONNECT" : "CLOSED");
+        break;
+    case ESP8266_TRACE_WIFI:
+        snprintf(buf, size, "WIFI     %s", a < 3 ? WIFI_STATES[a] : "?");
+        break;
+    default:
+        snprintf(buf, size, "?%02x      %02x %04x", code, a, b);
+        break;
+    }
+}
+
+static void decode(FILE *in)
+{
+    char line[256];
+    char text[64];
+    bool inside = false;
+    bool first = false;
+    unsigned long t0 = 0;
+    unsigned long prev = 0;
+    unsigned long t;
+    unsigned code, a, b;
+    
+    while (fgets(line, sizeof(line), in)) {
+        if (strstr(line, "ESP8266 TRACE BEGIN")) {
+            printf("%12s %10s  %s\n", "ms", "+ms", "event");
+            inside = true;
+            first = true;
+        } else if (strstr(line, "ESP8266 TRACE END")) {
+            printf("\n");
+            inside = false;
+        } else if (inside && sscanf(line, "%lx %x %x %x", &t, &code, &a, &b) == 4) {
+            if (first) {
+                t0 = prev = t;
+                first = false;
+            }
+            describe(code, a, b, text, sizeof(text));
+            /* micros() wraps in about 71 minutes, unsigned subtraction copes with it. */
+            printf("%12.3f %10.3f  %s\n", (uint32_t)(t - t0) / 1000.0, (uint32_t)(t - prev) / 1000.0, text);
+            prev = t;
+        }
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        decode(stdin);
+        return 0;
+    }
+    for (int i = 1; i < argc; i++) {
+        FILE *in = fopen(argv[i], "r");
+        if (!in) {
+            perror(argv[i]);
+            return 1;
+        }
+        decode(in);
+        fclose(in);
+    }
+    return 0;
+}